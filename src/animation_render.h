@@ -2,6 +2,7 @@
 #define SRC_ANIMATION_H_
 
 #include <cstdint>
+#include <algorithm>
 #include <libpekin.h>
 #include <graphics/primitives_render.h>
 #include "app.h"
@@ -57,15 +58,13 @@ public:
         time_ms_t now_ms = Libp::getMillis();
         bool updated = false;
 
-        uint32_t ms_since_last_frame = now_ms - p_anim1_->lastFrameTime();
-        if( p_anim1_ && (ms_since_last_frame > p_anim1_->msToNextFrame()) ) {
+        if( p_anim1_ && p_anim1_->isDue(now_ms) ) {
             if (!p_anim1_->update(painter_, now_ms))
                 p_anim1_ = nullptr;
             updated = true;
         }
 
-        ms_since_last_frame = now_ms - p_anim2_->lastFrameTime();
-        if( p_anim2_ && (ms_since_last_frame > p_anim2_->msToNextFrame()) ) {
+        if( p_anim2_ && p_anim2_->isDue(now_ms) ) {
             p_anim2_->update(painter_, now_ms);
             if (!p_anim2_->update(painter_, now_ms))
                 p_anim2_ = nullptr;
@@ -74,6 +73,20 @@ public:
         return updated;
     }
 
+    /**
+     * @return ms until `update` next needs to be called or UINT32_MAX if no
+     *         animations are active
+     */
+    time_ms_t msToNextUpdate(time_ms_t now_ms)
+    {
+        time_ms_t ms = UINT32_MAX;
+        if (p_anim1_)
+            ms = std::min(ms, p_anim1_->msUntilDue(now_ms));
+        if (p_anim2_)
+            ms = std::min(ms, p_anim2_->msUntilDue(now_ms));
+        return ms;
+    }
+
     /**
      * @return true if disconnect animation is still in progress
      */
@@ -101,6 +114,12 @@ private:
         void reset() { frame_ = 0; last_frame_time_ms_ = 0; ms_to_next_frame_ = 0; }
         time_ms_t lastFrameTime() { return last_frame_time_ms_; }
         time_ms_t msToNextFrame() { return ms_to_next_frame_; }
+        bool isDue(time_ms_t now_ms) { return (now_ms - last_frame_time_ms_) > ms_to_next_frame_; }
+        time_ms_t msUntilDue(time_ms_t now_ms)
+        {
+            time_ms_t elapsed = now_ms - last_frame_time_ms_;
+            return elapsed > ms_to_next_frame_ ? 0 : ms_to_next_frame_ + 1 - elapsed;
+        }
         bool update(Libp::PrimitivesRender<uint8_t>& painter, time_ms_t now_ms) {
             last_frame_time_ms_ = now_ms;
             return function_(painter, ms_to_next_frame_, frame_);
@@ -1,10 +1,14 @@
 #ifndef SRC_APP_H_
 #define SRC_APP_H_
 
+#include <cstdint>
+
 // TODO: move to bt_module.h
 enum class ModuleState {
     disconnected, pairing, connected, connected_streaming
 };
+inline constexpr uint8_t n_module_states = 4;
+static_assert(n_module_states == static_cast<uint8_t>(ModuleState::connected_streaming) + 1);
 
 
 #endif /* SRC_APP_H_ */
@@ -0,0 +1,109 @@
+#include <cstdlib>
+#include <cstring>
+#include "libpekin.h"
+#include <bt_module.h>
+
+bool BtModule::settingMatches(const Rn52Cmd& set, const char* value)
+{
+    const char* wanted = strchr(set.text, ',') + 1;
+    // Hex values may be read back with different leading zeros
+    char* wanted_end;
+    char* value_end;
+    const unsigned long wanted_num = strtoul(wanted, &wanted_end, 16);
+    const unsigned long value_num = strtoul(value, &value_end, 16);
+    if (*wanted_end == '\0' && *value_end == '\0' && *value != '\0')
+        return wanted_num == value_num;
+    return strcmp(wanted, value) == 0;
+}
+
+bool BtModule::probe()
+{
+    link_.discard();
+    engine_.submit(probe_cmd);
+    if (!engine_.runUntilIdle())
+        return false;
+    // Garbage at the wrong rate can look like a line
+    const char* value = engine_.lastValue();
+    char* end;
+    strtoul(value, &end, 16);
+    return end - value == 4 && *end == '\0';
+}
+
+bool BtModule::rebootAtBaud(uint32_t baud)
+{
+    engine_.submit(reboot_cmd);
+    // "Reboot" is still sent at the old rate, "CMD" comes at the new one
+    link_.setBaud(baud);
+    return engine_.runUntilIdle();
+}
+
+bool BtModule::findBaud()
+{
+    if (probe())
+        return true;
+    link_.setBaud(link_.baud() == Rn52Link::fast_baud ? Rn52Link::default_baud
+                                                      : Rn52Link::fast_baud);
+    return probe();
+}
+
+bool BtModule::negotiateBaud()
+{
+    if (!findBaud())
+        return false;
+    if (link_.baud() == Rn52Link::fast_baud)
+        return true;
+
+    engine_.submit(set_fast_baud_cmd);
+    // Even without "AOK" the rate may have been stored, the reboot tells
+    engine_.runUntilIdle();
+    if (rebootAtBaud(Rn52Link::fast_baud) && probe()) {
+        getErrHndlr().report("RN52 switched to %lu baud\r\n", Rn52Link::fast_baud);
+        return true;
+    }
+    // Rebooted at one of the two rates, or not at all with the fast rate
+    // stored. Stay at whichever answers and store it, a wake from sleep
+    // expects the module at the link's rate.
+    getErrHndlr().report("RN52 %lu baud failed\r\n", Rn52Link::fast_baud);
+    if (!findBaud())
+        return false;
+    if (link_.baud() == Rn52Link::default_baud) {
+        engine_.submit(set_default_baud_cmd);
+        engine_.runUntilIdle();
+    }
+    return true;
+}
+
+bool BtModule::init()
+{
+    const uint32_t start_ms = Libp::getMillis();
+#ifdef RN52_FAST_BAUD
+    if (!negotiateBaud())
+        return false;
+#else
+    // Never writes the rate, but a module switched before still answers
+    if (!findBaud())
+        return false;
+#endif
+    uint8_t n_changed = 0;
+    bool ok = true;
+    for (const Setting& setting : settings) {
+        engine_.submit(setting.get);
+        // A failed read is treated as a mismatch
+        if (engine_.runUntilIdle() && settingMatches(setting.set, engine_.lastValue()))
+            continue;
+        getErrHndlr().report("RN52 '%s' was '%s'\r\n", setting.set.text, engine_.lastValue());
+        engine_.submit(setting.set);
+        ok = engine_.runUntilIdle() && ok;
+        n_changed++;
+    }
+    // Settings take effect after a reboot
+    if (n_changed) {
+        engine_.submit(reboot_cmd);
+        ok = engine_.runUntilIdle() && ok;
+        // Comes up at the rate it has stored, check it's still ours
+        ok = findBaud() && ok;
+    }
+    getErrHndlr().report("RN52 configured in %lu ms, %u settings changed\r\n",
+            Libp::getMillis() - start_ms, n_changed);
+    return ok;
+}
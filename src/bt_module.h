@@ -2,86 +2,223 @@
 #define SRC_BT_MODULE_H_
 
 #include <drivers/wireless/rn_52.h>
+#include <devices/rn52_link.h>
+#include <rn52_cmd_engine.h>
+#include <volume_model.h>
 
+/**
+ * RN52 command set. Commands are queued on the `Rn52CmdEngine` and return
+ * straight away; `true` only means the command was queued.
+ *
+ * Status types are shared with `Libp::Rn52`.
+ */
 class BtModule {
 public:
-    BtModule(Libp::Rn52& rn52) : rn52_(rn52) { }
+    BtModule(Rn52Link& link, EventQueue& event_queue)
+            : link_(link), engine_(link, event_queue) { }
 
-    static constexpr char dev_name[] = "Bath One";
-    // 0x200414 : audio->audio/video->loudspeaker
-    // 0x240414 : audio/rendering->audio/video->loudspeaker
-    static constexpr char cod[] = { '2','0','0','4','1','4' };
+    /**
+     * Blocking. Switches the link to `Rn52Link::fast_baud` if
+     * RN52_FAST_BAUD, otherwise finds the rate the module is at. Then
+     * reads the configuration back and writes only the settings that
+     * differ, rebooting the module only if any did.
+     */
+    bool init();
 
-    bool init()
+    /// Posts `rn52_status` when done, result from `lastStatus`
+    bool requestStatus()
     {
-        bool success =
-                rn52_.setDevName(dev_name)
-             && rn52_.setCod(cod)
-             && rn52_.setDiscoveryMask<Libp::Rn52::Profile::a2dp>()
-             && rn52_.setAudioOut(Libp::Rn52::AudioOutput::analog, Libp::Rn52::BitsPerSample::bits_24, Libp::Rn52::SampleRate::rate_44k)
-             && rn52_.setConnectionMask<Libp::Rn52::Profile::a2dp>()
-             && rn52_.setAuth(Libp::Rn52::AuthMethod::ssp_keyboard)
-             && rn52_.setFeatures<Libp::Rn52::Feature::en_track_change_event>()
-             && rn52_.actReboot();
-        return success;
+        return engine_.submit(query_status_cmd);
     }
-    uint16_t queryStatus()
+    /// @return `Libp::Rn52::query_status_error` if the query failed
+    uint16_t lastStatus() const
     {
-        return rn52_.actQueryStatus();
+        return engine_.lastStatus();
     }
-    bool reboot()
+    /**
+     * Stream metadata into `track_info`. Posts `rn52_meta_field` as fields
+     * complete (see `takeMetaFields`) and `rn52_metadata` when done.
+     */
+    bool requestMetadata(TrackInfo& track_info)
     {
-        return rn52_.actReboot();
+        return engine_.submit(metadata_cmd, &track_info);
     }
-
-    bool getMetadata(Libp::Rn52::MetaData* metadata)
+    bool lastMetadataOk() const
+    {
+        return engine_.lastMetadataOk();
+    }
+    /// @return mask of `trackFieldBit` completed since the last call
+    uint8_t takeMetaFields()
     {
-        return rn52_.avrcpGetMetaData(metadata);
+        return engine_.takeMetaFields();
+    }
+    /// @return mask of `trackFieldBit` received by the last request
+    uint8_t metaFieldsReceived() const
+    {
+        return engine_.metaFieldsReceived();
     }
 
     bool enterPairingMode()
     {
-        return rn52_.basicActionCmd(Libp::Rn52::Cmd::dicoverable_on);
+        return engine_.submit(discoverable_on_cmd);
     }
     bool exitPairingMode()
     {
-        return rn52_.basicActionCmd(Libp::Rn52::Cmd::dicoverable_off);
+        return engine_.submit(discoverable_off_cmd);
     }
-    bool awaitPairingPasskey(char (&passkey)[6])
+    bool acceptPairing()
     {
-        // Animation frames are ~80ms apart so wait for 50ms
-        return rn52_.awaitPairingPasskey(passkey, 50);
+        return engine_.submit(accept_pairing_cmd);
     }
-    bool acceptPairing()
+    /// Reconnect to the last connected phone, if it's in range
+    bool reconnect()
     {
-        return rn52_.basicActionCmd(Libp::Rn52::Cmd::accept_pairing);
+        return engine_.submit(reconnect_cmd);
     }
     bool resetPairings()
     {
-        return rn52_.basicActionCmd(Libp::Rn52::Cmd::clear_saved_pairings);
+        return engine_.submit(clear_pairings_cmd);
     }
     void volUp()
     {
-        rn52_.basicActionCmd(Libp::Rn52::Cmd::avrcp_vol_up);
+        if (engine_.submit(vol_up_cmd))
+            volume_.stepUp();
     }
     void volDown()
     {
-        rn52_.basicActionCmd(Libp::Rn52::Cmd::avrcp_vol_down);
+        if (engine_.submit(vol_down_cmd))
+            volume_.stepDown();
+    }
+    /// Local volume estimate, see `VolumeModel`
+    const VolumeModel& volume() const
+    {
+        return volume_;
+    }
+    /// Call on `rn52_vol_event`
+    void notifyVolumeChanged()
+    {
+        volume_.notifyChanged();
+    }
+    /// Call when a source (dis)connects
+    void forgetVolume()
+    {
+        volume_.forget();
     }
     void trackNext()
     {
-        rn52_.basicActionCmd(Libp::Rn52::Cmd::avrcp_next);
+        engine_.submit(track_next_cmd);
     }
     void trackPrev()
     {
-        rn52_.basicActionCmd(Libp::Rn52::Cmd::avrcp_prev);
+        engine_.submit(track_prev_cmd);
     }
     void playPause()
     {
-        rn52_.basicActionCmd(Libp::Rn52::Cmd::avrcp_play_pause);
+        engine_.submit(play_pause_cmd);
+    }
+
+    /// Call on `rn52_rx` and when `msToDeadline` expires
+    void poll(uint32_t now_ms)
+    {
+        engine_.poll(now_ms);
+    }
+    uint32_t msToDeadline(uint32_t now_ms) const
+    {
+        return engine_.msToDeadline(now_ms);
+    }
+    /// Module is being powered down
+    void cancelAll()
+    {
+        engine_.cancelAll();
+    }
+
+    void reportStats()
+    {
+        link_.reportStats();
+        engine_.reportStats();
+        volume_.reportStats();
     }
 private:
-    Libp::Rn52& rn52_;
+    using R = Rn52Response;
+
+    // 0x200414 : audio->audio/video->loudspeaker
+    // 0x240414 : audio/rendering->audio/video->loudspeaker
+    static constexpr Rn52Cmd set_name_cmd       { "SN,Bath One", R::aok, 100, 2 };
+    static constexpr Rn52Cmd set_cod_cmd        { "SC,200414",   R::aok, 100, 2 };
+    static constexpr Rn52Cmd set_discovery_cmd  { "SD,04",       R::aok, 100, 2 }; // A2DP
+    static constexpr Rn52Cmd set_audio_out_cmd  { "S|,0002",     R::aok, 100, 2 }; // analog, 24 bit, 44.1 kHz
+    static constexpr Rn52Cmd set_connection_cmd { "SK,04",       R::aok, 100, 2 }; // A2DP
+    static constexpr Rn52Cmd set_auth_cmd       { "SA,1",        R::aok, 100, 2 }; // SSP keyboard
+    static constexpr Rn52Cmd set_features_cmd   { "S%,1000",     R::aok, 100, 2 }; // track change event
+    static constexpr Rn52Cmd reboot_cmd         { "R,1",         R::reboot, 3000, 0 };
+    /// SU codes per the RN52 Command Reference User's Guide, SU table:
+    /// 07 is 115200 (the default), 09 is 460800
+    static constexpr Rn52Cmd set_fast_baud_cmd  { "SU,09",       R::aok, 100, 2 }; // 460800
+    static constexpr Rn52Cmd set_default_baud_cmd { "SU,07",     R::aok, 100, 2 }; // 115200
+    /// Status query that posts no event, for probing the link
+    static constexpr Rn52Cmd probe_cmd          { "Q",           R::value, 50, 1 };
+
+    static constexpr Rn52Cmd get_name_cmd       { "GN", R::value, 100, 2 };
+    static constexpr Rn52Cmd get_cod_cmd        { "GC", R::value, 100, 2 };
+    static constexpr Rn52Cmd get_discovery_cmd  { "GD", R::value, 100, 2 };
+    static constexpr Rn52Cmd get_audio_out_cmd  { "G|", R::value, 100, 2 };
+    static constexpr Rn52Cmd get_connection_cmd { "GK", R::value, 100, 2 };
+    static constexpr Rn52Cmd get_auth_cmd       { "GA", R::value, 100, 2 };
+    static constexpr Rn52Cmd get_features_cmd   { "G%", R::value, 100, 2 };
+
+    /// Setting read back with `get`, written with `set` if it differs
+    struct Setting {
+        const Rn52Cmd& get;
+        const Rn52Cmd& set;
+    };
+    static constexpr Setting settings[] = {
+        { get_name_cmd,       set_name_cmd },
+        { get_cod_cmd,        set_cod_cmd },
+        { get_discovery_cmd,  set_discovery_cmd },
+        { get_audio_out_cmd,  set_audio_out_cmd },
+        { get_connection_cmd, set_connection_cmd },
+        { get_auth_cmd,       set_auth_cmd },
+        { get_features_cmd,   set_features_cmd },
+    };
+    /// @return true if `value` read back matches the value `set` writes
+    static bool settingMatches(const Rn52Cmd& set, const char* value);
+
+    /**
+     * Find the module's baud rate and switch it to `Rn52Link::fast_baud`.
+     * The RN52 stores the rate, so this is a no-op on later boots.
+     *
+     * Only the fast and default rates are ever set, and the link ends at
+     * whichever of them the module answers, so a failed switch can't leave
+     * the module unreachable.
+     *
+     * @return false if the module doesn't answer at either rate
+     */
+    bool negotiateBaud();
+    /// @return true if the module answers at the fast or default rate,
+    /// trying the link's current rate first and leaving the link at it
+    bool findBaud();
+    /// @return true if the module answers a status query at the link's rate
+    bool probe();
+    /// Reboot the module, switching the link to `baud` for it to come up at
+    bool rebootAtBaud(uint32_t baud);
+
+    static constexpr Rn52Cmd query_status_cmd     { "Q",   R::status,   100, 2 };
+    static constexpr Rn52Cmd metadata_cmd         { "AD",  R::metadata, 100, 1 };
+    static constexpr Rn52Cmd discoverable_on_cmd  { "@,1", R::aok,      100, 1 };
+    static constexpr Rn52Cmd discoverable_off_cmd { "@,0", R::aok,      100, 1 };
+    static constexpr Rn52Cmd accept_pairing_cmd   { "#,1", R::aok,      100, 0 };
+    static constexpr Rn52Cmd clear_pairings_cmd   { "U",   R::aok,      100, 1 };
+    static constexpr Rn52Cmd reconnect_cmd        { "B",   R::aok,      100, 1 };
+    // Not repeatable, a lost AOK would skip twice
+    static constexpr Rn52Cmd vol_up_cmd           { "AV+", R::aok,      100, 0 };
+    static constexpr Rn52Cmd vol_down_cmd         { "AV-", R::aok,      100, 0 };
+    static constexpr Rn52Cmd track_next_cmd       { "AT+", R::aok,      100, 0 };
+    static constexpr Rn52Cmd track_prev_cmd       { "AT-", R::aok,      100, 0 };
+    static constexpr Rn52Cmd play_pause_cmd       { "AP",  R::aok,      100, 0 };
+
+    Rn52Link& link_;
+    Rn52CmdEngine engine_;
+    VolumeModel volume_;
 };
 
 #endif /* SRC_BT_MODULE_H_ */
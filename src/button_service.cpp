@@ -0,0 +1,86 @@
+#include <algorithm>
+#include <button_service.h>
+
+using namespace Libp;
+
+static constexpr uint8_t btn_play_idx = 0;
+static constexpr uint8_t btn_vol_up_idx = 3;
+static constexpr uint8_t btn_vol_dn_idx = 4;
+
+// Button index n maps to EventType::btn_play + n
+static_assert(enumBaseT(EventType::btn_next) == enumBaseT(EventType::btn_play) + 1);
+static_assert(enumBaseT(EventType::btn_prev) == enumBaseT(EventType::btn_play) + 2);
+static_assert(enumBaseT(EventType::btn_vol_up) == enumBaseT(EventType::btn_play) + btn_vol_up_idx);
+static_assert(enumBaseT(EventType::btn_vol_dn) == enumBaseT(EventType::btn_play) + btn_vol_dn_idx);
+
+static EventType pressEvent(uint8_t idx)
+{
+    return static_cast<EventType>(enumBaseT(EventType::btn_play) + idx);
+}
+
+bool ButtonService::sample(uint8_t levels)
+{
+    bool active = false;
+    for (uint8_t i = 0; i < n_buttons; i++) {
+        Button& btn = buttons_[i];
+        if (levels & (1u << i)) {
+            if (btn.integrator < integrator_max)
+                btn.integrator++;
+        }
+        else if (btn.integrator > 0) {
+            btn.integrator--;
+        }
+
+        if (!btn.pressed && btn.integrator == integrator_max) {
+            onPress(i, btn);
+        }
+        else if (btn.pressed && btn.integrator == 0) {
+            btn.pressed = false;
+            if (i == btn_play_idx)
+                event_queue_.postEvent(EventType::btn_play_release);
+        }
+        else if (btn.pressed) {
+            btn.held_ms += sample_period_ms;
+            if (btn.held_ms >= btn.next_hold_event_ms)
+                onHold(i, btn);
+        }
+        active = active || btn.pressed || btn.integrator != 0;
+    }
+    sampling_ = active;
+    return active;
+}
+
+void ButtonService::onPress(uint8_t idx, Button& btn)
+{
+    btn.pressed = true;
+    btn.held_ms = 0;
+    btn.repeat_interval_ms = repeat_cfg_.start_interval_ms;
+    switch (idx) {
+    case btn_play_idx:
+        btn.next_hold_event_ms = long_press_ms;
+        break;
+    case btn_vol_up_idx:
+    case btn_vol_dn_idx:
+        btn.next_hold_event_ms = repeat_cfg_.initial_delay_ms;
+        break;
+    default:
+        btn.next_hold_event_ms = no_hold_event;
+        break;
+    }
+    event_queue_.postEvent(pressEvent(idx));
+}
+
+void ButtonService::onHold(uint8_t idx, Button& btn)
+{
+    if (idx == btn_play_idx) {
+        event_queue_.postEvent(EventType::btn_play_long_press);
+        btn.next_hold_event_ms = no_hold_event;
+        return;
+    }
+    // Volume auto-repeat
+    event_queue_.postEvent(pressEvent(idx));
+    btn.next_hold_event_ms = btn.held_ms + btn.repeat_interval_ms;
+    btn.repeat_interval_ms = std::max<int32_t>(
+            repeat_cfg_.min_interval_ms,
+            btn.repeat_interval_ms - repeat_cfg_.accel_ms);
+}
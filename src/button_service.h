@@ -0,0 +1,84 @@
+#ifndef SRC_BUTTON_SERVICE_H_
+#define SRC_BUTTON_SERVICE_H_
+
+#include <cstdint>
+#include <event_queue.h>
+
+/// Hold-to-repeat timing for the volume buttons
+struct BtnRepeatConfig {
+    uint16_t initial_delay_ms = 500; ///< hold time before the first repeat
+    uint16_t start_interval_ms = 200;///< first repeat interval
+    uint16_t min_interval_ms = 60;   ///< fastest repeat interval
+    uint16_t accel_ms = 20;          ///< interval reduction per repeat
+};
+
+/**
+ * Debounces the capacitive buttons by sampling them from a periodic timer.
+ *
+ * A button edge irq starts the sample timer (`notifyEdge`). Each sample feeds
+ * an integrator per button: the button is reported pressed when the
+ * integrator saturates and released when it drains back to zero, so bounce
+ * shorter than the debounce time never produces an event. Sampling stops
+ * once every button has settled released.
+ *
+ * While held:
+ *  - play posts `btn_play_long_press` after `long_press_ms`
+ *  - vol+/vol- repeat with an accelerating interval (see `BtnRepeatConfig`)
+ *
+ * Button bit order (in `sample` levels) matches `EventType::btn_play` ->
+ * `EventType::btn_vol_dn`.
+ */
+class ButtonService {
+public:
+    static constexpr uint32_t sample_period_ms = btn_sample_period_us / 1000;
+    static constexpr uint32_t debounce_ms = 10;
+    static constexpr uint32_t long_press_ms = 2000;
+
+    ButtonService(EventQueue& event_queue, BtnRepeatConfig repeat_cfg = {})
+            : event_queue_(event_queue), repeat_cfg_(repeat_cfg) { }
+
+    /**
+     * Call from the button edge irq.
+     *
+     * @return true if the sample timer must be started
+     */
+    bool notifyEdge()
+    {
+        if (sampling_)
+            return false;
+        sampling_ = true;
+        return true;
+    }
+
+    /**
+     * Call from the sample timer irq every `sample_period_ms`.
+     *
+     * @param levels bit n set if button n currently reads pressed
+     * @return false once all buttons have settled released and the sample
+     *         timer can be stopped
+     */
+    bool sample(uint8_t levels);
+
+private:
+    static constexpr uint8_t n_buttons = 5;
+    static constexpr uint8_t integrator_max = debounce_ms / sample_period_ms;
+    static constexpr uint32_t no_hold_event = UINT32_MAX;
+
+    struct Button {
+        uint8_t integrator;
+        bool pressed;
+        uint16_t repeat_interval_ms;
+        uint32_t held_ms;
+        uint32_t next_hold_event_ms; ///< held_ms at which to post the next hold event
+    };
+
+    EventQueue& event_queue_;
+    const BtnRepeatConfig repeat_cfg_;
+    Button buttons_[n_buttons] = {};
+    bool sampling_ = false;
+
+    void onPress(uint8_t idx, Button& btn);
+    void onHold(uint8_t idx, Button& btn);
+};
+
+#endif /* SRC_BUTTON_SERVICE_H_ */
@@ -0,0 +1,55 @@
+#ifndef SRC_CYCLE_COUNTER_H_
+#define SRC_CYCLE_COUNTER_H_
+
+#include <cstdint>
+
+/*
+ * Free running cycle counter used for timestamps and profiling.
+ *
+ * On target this is the Cortex-M3 DWT cycle counter (wraps after ~179s at
+ * 24MHz, so only use for intervals). On the host a monotonic clock in ns is
+ * used instead.
+ */
+
+#ifdef __arm__
+
+#include <stm32f1xx.h>
+
+/// Enable the DWT cycle counter. Call once at startup.
+inline void initCycleCounter()
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+inline uint32_t cycleCount()
+{
+    return DWT->CYCCNT;
+}
+
+inline uint32_t cyclesToUs(uint32_t cycles)
+{
+    return cycles / (SystemCoreClock / 1'000'000);
+}
+
+#else
+
+#include <chrono>
+
+inline void initCycleCounter() { }
+
+inline uint32_t cycleCount()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+inline uint32_t cyclesToUs(uint32_t cycles)
+{
+    return cycles / 1'000;
+}
+
+#endif
+
+#endif /* SRC_CYCLE_COUNTER_H_ */
@@ -1,9 +1,11 @@
+#include <algorithm>
 #include "serial/spi_bus_stm32f1xx.h"
 #include "drivers/display/sh1122_driver.h"
 #include "drivers/display/ssd1362_driver.h"
 #include "devices/peripherals.h"
 #include "misc_math.h"
 #include "display.h"
+#include "oled.h"
 
 
 static LibpStm32::Spi::SpiBus<SPI1_BASE> spi;
@@ -27,7 +29,8 @@ Libp::IDrawingSurface<uint8_t>& getOled()
 
 static uint32_t rollingAvg(uint32_t avg, uint32_t new_val)
 {
-    constexpr uint16_t n = 1000;
+    // ~5s averaging window
+    constexpr uint16_t n = 5000 / oled_brightness_period_ms;
     static uint16_t remainder = 0;
     uint32_t sum = (avg * (n-1) + new_val + remainder);
     uint32_t new_avg = sum / n;
@@ -65,11 +68,13 @@ void oledUpdateBrightness(uint32_t ambient_millilux)
     static uint8_t current_brightness = milliLuxToBrightness(starting_millilux);
 
     avg_millilux = rollingAvg(avg_millilux, ambient_millilux);
+    // Limit step size so changes fade rather than jump
+    constexpr uint8_t max_step = 4;
     uint8_t tgt_brightness = milliLuxToBrightness(avg_millilux);
     if (tgt_brightness > current_brightness)
-        current_brightness++;
+        current_brightness += std::min<uint8_t>(max_step, tgt_brightness - current_brightness);
     else if (tgt_brightness < current_brightness)
-        current_brightness--;
+        current_brightness -= std::min<uint8_t>(max_step, current_brightness - tgt_brightness);
     display.setBrightness(current_brightness);
 }
 
@@ -1,6 +1,7 @@
 #ifndef SRC_DEVICES_OLED_H_
 #define SRC_DEVICES_OLED_H_
 
+#include <cstdint>
 #include "graphics/idrawing_surface.h"
 
 Libp::IDrawingSurface<uint8_t>& getOled();
@@ -8,9 +9,14 @@ Libp::IDrawingSurface<uint8_t>& getOled();
 /// Start SPI and initialize the display
 void oledInit();
 
+/// `oledUpdateBrightness` should be called at this interval
+inline constexpr uint32_t oled_brightness_period_ms = 1000;
+
 /**
  * Update the OLED brightness based on ambient light levels.
  *
+ * Call every `oled_brightness_period_ms`.
+ *
  * @param ambient_millilux Ambient light level in millilux
  */
 void oledUpdateBrightness(uint32_t ambient_millilux);
@@ -44,18 +44,21 @@ inline constexpr uint32_t i2c_freq = 100'000;
 // in less SRAM and Flash usage vs inline for some reason.
 static LibpStm32::I2c::I2cBus<I2C1_BASE, i2c_freq> i2c_bus;
 
+// Must be lower than SysTick so we can use ms timers in the ISRs and
+// not mess up other timing.
+//
+// RN52, all buttons and the button sample timer must have the same priority
+// to ensure they don't interrupt each other as the event posting handlers do
+// not support reentrancy.
+inline constexpr uint32_t btn_and_rn52_irq_priority = 1;
+
+/// Button sample timer (TIM3) period
+inline constexpr uint32_t btn_sample_period_us = 2000;
+
 /// Must call before peripherals init
 inline __attribute__((always_inline))
 void initGpio()
 {
-    // Must be lower than SysTick so we can use ms timers in the ISRs and
-    // not mess up other timing.
-    //
-    // RN52 and all buttons must have the same priority to ensure they don't
-    // interrupt each other as the event posting handlers do not support
-    // reentrancy.
-    static constexpr uint32_t btn_and_rn52_irq_priority = 1;
-
     LibpStm32::Clk::enable<
             LibpStm32::Clk::Apb2::afio, // for external interrupts
             LibpStm32::Clk::Apb2::iopa,
@@ -119,6 +122,39 @@ void initTimers()
     // TIM2 CH2
     LibpStm32::Clk::enable<LibpStm32::Clk::Apb1::tim2>();
     Pins::out_haptic.setAsOutput(LibpStm32::OutputMode::alt_pushpull, LibpStm32::OutputSpeed::low);
+
+    // TIM3 - button sample timer, update irq only, started on button edge
+    LibpStm32::Clk::enable<LibpStm32::Clk::Apb1::tim3>();
+    TIM3->PSC = SystemCoreClock / 1'000'000 - 1; // 1us tick (APB1 div1)
+    TIM3->ARR = btn_sample_period_us - 1;
+    TIM3->EGR = TIM_EGR_UG;                       // load PSC
+    TIM3->SR = 0;
+    TIM3->DIER = TIM_DIER_UIE;
+    NVIC_SetPriority(TIM3_IRQn, btn_and_rn52_irq_priority);
+}
+
+inline
+void startBtnSampleTimer()
+{
+    TIM3->CNT = 0;
+    TIM3->CR1 |= TIM_CR1_CEN;
+}
+
+inline
+void stopBtnSampleTimer()
+{
+    TIM3->CR1 &= ~TIM_CR1_CEN;
+}
+
+/// Bit n set if button n is pressed (order matches EventType::btn_play...)
+inline
+uint8_t readBtnLevels()
+{
+    return Pins::btn_play.read()
+         | Pins::btn_next.read()   << 1
+         | Pins::btn_prev.read()   << 2
+         | Pins::btn_vol_up.read() << 3
+         | Pins::btn_vol_dn.read() << 4;
 }
 
 /// Assumes relevant GPIO clocks are already enabled
@@ -159,10 +195,11 @@ void initI2c()
 }
 
 
-/// Disable RN52 and button interrupts
+/// Disable RN52, button and button sample timer interrupts
 inline
 void disableExtIrqs()
 {
+    NVIC_DisableIRQ(TIM3_IRQn);
     Pins::rn52_gpio2.disableIrq();
     Pins::btn_vol_up.disableIrq();
     Pins::btn_vol_dn.disableIrq();
@@ -198,7 +235,7 @@ void clearExtIrqs()
 }
 
 /**
- * Enable RN52 and button interrupts
+ * Enable RN52, button and button sample timer interrupts
  *
  * @param clear_first clear int pending flags prior to enabling.
  */
@@ -218,6 +255,7 @@ void enableExtIrqs(bool clear_first = true)
     Pins::btn_next.enableIrq();
     Pins::proximity_int.enableIrq();
     Pins::rtc_int.enableIrq();
+    NVIC_EnableIRQ(TIM3_IRQn);
 }
 
 /// Enable interrupts to wakeup from sleep
@@ -1,47 +1,67 @@
+#include <cstring>
 #include "libpekin.h"
 #include "libpekin_stm32_hal.h"
 
-#include "serial/uart_stm32f1xx.h"
-#include "serial/i_serial_io.h"
-
 #include "peripherals.h"
-#include <drivers/wireless/rn_52.h>
+#include "rn52.h"
 
 #include <error_handler.h>
 
 using namespace Libp;
 using namespace LibpStm32;
 
-static constexpr uint32_t uart_baud = 115200;
-/// Needs to be large enough for unsolicited metadata
-static constexpr uint16_t uart_buffer_len = 512;
+static Rn52Link rn52_link;
+
+/// Give up waiting for "CMD" after this long, module boots in about 1 s
+static constexpr uint32_t boot_timeout_ms = 2000;
 
-static Uart::UartIo<USART1_BASE, Uart::IrqMode::interrupt, uart_buffer_len> uart;
-static Rn52 rn52(uart);
+static uint32_t power_up_ms;
 
-static void powerUpRn52()
+void startRn52()
 {
+    // Module keeps the negotiated rate over power cycles, try that first
+#ifdef RN52_FAST_BAUD
+    constexpr uint32_t first_baud = Rn52Link::fast_baud;
+#else
+    constexpr uint32_t first_baud = Rn52Link::default_baud;
+#endif
+    rn52_link.start(rn52_link.baud() ? rn52_link.baud() : first_baud);
+
     Pins::rn52_cmd_mode.clear();
     Pins::rn52_pwr_en.set();
     Pins::pwr_en_rn52_disp.set();
-    // Read past "CMD\r\n" or anything else on boot
-    char buf;
-    uart.read(&buf, 1, 2000);
-    while (uart.read(&buf, 1, 10))
-            ;
+    power_up_ms = getMillis();
+}
+
+bool pollRn52Boot()
+{
+    // Module is ready as soon as it prints "CMD", anything before is noise
+    const uint32_t elapsed_ms = getMillis() - power_up_ms;
+    const char* line;
+    while (rn52_link.readLine(line)) {
+        if (strncmp(line, "CMD", 3) == 0) {
+            getErrHndlr().report("RN52 booted in %lu ms\r\n", elapsed_ms);
+            return true;
+        }
+    }
+    if (elapsed_ms > boot_timeout_ms) {
+        // Try commands anyway, they fail if it really didn't boot
+        getErrHndlr().report("RN52 boot timeout\r\n");
+        return true;
+    }
+    return false;
 }
 
 void initRn52()
 {
-    uart.start(Uart::Mode::rx_tx, Uart::Parity::none, Uart::StopBits::bits_1, uart_baud);
-    uart.configIrq<Uart::IrqType::rx_data_ready>();
-    uart.enableIrq();
-    powerUpRn52();
+    startRn52();
+    while (!pollRn52Boot())
+        ;
 }
 
-Rn52& getRn52()
+Rn52Link& getRn52Link()
 {
-    return rn52;
+    return rn52_link;
 }
 
 
@@ -52,10 +72,13 @@ extern "C" {
 __attribute__ ((interrupt("IRQ")))
 void USART1_IRQHandler(void)
 {
-    uart.clearPendingIrq();
-    if (uart.isOverrun())
-        getErrHndlr().halt(ErrCode::uart_overrun, "Usart overrun");
-    uart.serviceIrq();
+    rn52_link.serviceUsartIrq();
+}
+
+__attribute__ ((interrupt("IRQ")))
+void DMA1_Channel5_IRQHandler(void)
+{
+    rn52_link.serviceDmaIrq();
 }
 
 #ifdef __cplusplus
@@ -3,15 +3,30 @@
 #ifndef SRC_DEVICES_RN52_H_
 #define SRC_DEVICES_RN52_H_
 
-#include <drivers/wireless/rn_52.h>
+#include <devices/rn52_link.h>
 
 /**
- * Start RN52 UART and power up module.
+ * Start RN52 UART and power up module. Blocks until the module has booted.
  */
 void initRn52();
 
+/**
+ * Start RN52 UART and power up module without waiting for it to boot.
+ *
+ * `pollRn52Boot` must then be called regularly until it returns true before
+ * sending any commands.
+ */
+void startRn52();
+
+/**
+ * Non-blocking. Discards the boot output ("CMD\r\n").
+ *
+ * @return true once the module has booted
+ */
+bool pollRn52Boot();
+
 
-Libp::Rn52& getRn52();
+Rn52Link& getRn52Link();
 
 
 #endif /* SRC_DEVICES_RN52_H_ */
@@ -0,0 +1,187 @@
+#include <algorithm>
+#include "libpekin.h"
+#include "libpekin_stm32_hal.h"
+
+#include "peripherals.h"
+#include "rn52_link.h"
+
+#include <error_handler.h>
+
+using namespace Libp;
+
+/// USART1 is on APB2
+static uint32_t usart1ClkHz()
+{
+    return SystemCoreClock >> APBPrescTable[(RCC->CFGR & RCC_CFGR_PPRE2) >> RCC_CFGR_PPRE2_Pos];
+}
+
+void Rn52Link::start(uint32_t baud)
+{
+    NVIC_DisableIRQ(USART1_IRQn);
+    NVIC_DisableIRQ(DMA1_Channel5_IRQn);
+    USART1->CR1 = 0;
+    DMA1_Channel5->CCR = 0;
+
+    // USART1 RX is hardwired to DMA1 channel 5
+    RCC->AHBENR |= RCC_AHBENR_DMA1EN;
+    DMA1->IFCR = DMA_IFCR_CGIF5;
+    DMA1_Channel5->CPAR = reinterpret_cast<uint32_t>(&USART1->DR);
+    DMA1_Channel5->CMAR = reinterpret_cast<uint32_t>(rx_buf_);
+    DMA1_Channel5->CNDTR = rx_buf_len;
+    DMA1_Channel5->CCR = DMA_CCR_MINC | DMA_CCR_CIRC | DMA_CCR_HTIE | DMA_CCR_TCIE
+                       | DMA_CCR_PL_1 | DMA_CCR_EN;
+
+    rx_written_ = 0;
+    rx_read_ = 0;
+    dma_pos_ = 0;
+    line_len_ = 0;
+    line_truncated_ = false;
+
+    baud_ = baud;
+    USART1->BRR = (usart1ClkHz() + baud / 2) / baud;
+    USART1->CR3 = USART_CR3_DMAR;
+    USART1->CR1 = USART_CR1_UE | USART_CR1_TE | USART_CR1_RE | USART_CR1_IDLEIE;
+
+    NVIC_SetPriority(USART1_IRQn, btn_and_rn52_irq_priority);
+    NVIC_SetPriority(DMA1_Channel5_IRQn, btn_and_rn52_irq_priority);
+    NVIC_EnableIRQ(USART1_IRQn);
+    NVIC_EnableIRQ(DMA1_Channel5_IRQn);
+}
+
+void Rn52Link::setBaud(uint32_t baud)
+{
+    while (!(USART1->SR & USART_SR_TC))
+        ;
+    USART1->CR1 &= ~USART_CR1_UE;
+    baud_ = baud;
+    USART1->BRR = (usart1ClkHz() + baud / 2) / baud;
+    USART1->CR1 |= USART_CR1_UE;
+    // Anything received during the switch is garbage
+    discard();
+}
+
+void Rn52Link::write(const char* str)
+{
+    while (*str) {
+        while (!(USART1->SR & USART_SR_TXE))
+            ;
+        USART1->DR = static_cast<uint8_t>(*str++);
+    }
+}
+
+void Rn52Link::updateWritePos()
+{
+    // CNDTR counts down and reloads on wrap
+    const uint16_t pos = (rx_buf_len - DMA1_Channel5->CNDTR) & (rx_buf_len - 1);
+    rx_written_ += (pos - dma_pos_) & (rx_buf_len - 1);
+    dma_pos_ = pos;
+}
+
+uint32_t Rn52Link::available()
+{
+    __disable_irq();
+    updateWritePos();
+    const uint32_t n = rx_written_ - rx_read_;
+    __enable_irq();
+
+    if (n > rx_buf_len) {
+        // Lapped, what's left is a mix of old and new data
+        n_rx_overflows_++;
+        rx_read_ += n;
+        line_len_ = 0;
+        line_truncated_ = false;
+        return 0;
+    }
+    return n;
+}
+
+bool Rn52Link::readLine(const char*& line)
+{
+    for (uint32_t n = available(); n > 0; n--) {
+        const char c = rx_buf_[rx_read_++ & (rx_buf_len - 1)];
+        if (c == '\r')
+            continue;
+        if (c == '\n') {
+            if (line_len_ == 0)
+                continue;
+            line_[line_len_] = '\0';
+            line_len_ = 0;
+            line_truncated_ = false;
+            line = line_;
+            return true;
+        }
+        if (line_len_ < max_line_len)
+            line_[line_len_++] = c;
+        else if (!line_truncated_) {
+            n_truncated_lines_++;
+            line_truncated_ = true;
+        }
+    }
+    return false;
+}
+
+uint16_t Rn52Link::peek(const char*& data)
+{
+    const uint32_t n = available();
+    const uint16_t read_pos = rx_read_ & (rx_buf_len - 1);
+    data = reinterpret_cast<const char*>(&rx_buf_[read_pos]);
+    // Up to the end of the buffer, the rest on the next call
+    return std::min<uint32_t>(n, rx_buf_len - read_pos);
+}
+
+bool Rn52Link::awaitLine(const char*& line, uint32_t timeout_ms)
+{
+    const uint32_t start_ms = getMillis();
+    do {
+        if (readLine(line))
+            return true;
+    } while (getMillis() - start_ms < timeout_ms);
+    return false;
+}
+
+uint16_t Rn52Link::discard()
+{
+    const uint32_t n = available();
+    rx_read_ += n;
+    line_len_ = 0;
+    line_truncated_ = false;
+    return n;
+}
+
+void Rn52Link::serviceUsartIrq()
+{
+    n_usart_irqs_++;
+    const uint32_t sr = USART1->SR;
+    if (sr & (USART_SR_IDLE | USART_SR_ORE)) {
+        // SR then DR read clears both. DMA has already taken the data.
+        (void)USART1->DR;
+        if (sr & USART_SR_ORE)
+            n_overruns_++;
+        if (sr & USART_SR_IDLE)
+            n_bursts_++;
+    }
+    notifyRx();
+}
+
+void Rn52Link::serviceDmaIrq()
+{
+    n_dma_irqs_++;
+    DMA1->IFCR = DMA_IFCR_CGIF5;
+    notifyRx();
+}
+
+void Rn52Link::notifyRx()
+{
+    const uint32_t prev_written = rx_written_;
+    updateWritePos();
+    if (rx_written_ != prev_written && rx_callback_)
+        rx_callback_();
+}
+
+void Rn52Link::reportStats()
+{
+    getErrHndlr().report("RN52 rx: %lu baud, %lu bytes, %lu bursts, irqs usart=%lu dma=%lu\r\n",
+            baud_, rx_written_, n_bursts_, n_usart_irqs_, n_dma_irqs_);
+    getErrHndlr().report("RN52 rx errors: overrun=%lu overflow=%lu truncated=%lu\r\n",
+            n_overruns_, n_rx_overflows_, n_truncated_lines_);
+}
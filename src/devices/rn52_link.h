@@ -0,0 +1,137 @@
+#ifndef SRC_DEVICES_RN52_LINK_H_
+#define SRC_DEVICES_RN52_LINK_H_
+
+#include <cstdint>
+
+// Uncomment to switch the RN52 to `Rn52Link::fast_baud` on boot. The rate
+// is stored in the module, so this stays off until verified on hardware.
+//#define RN52_FAST_BAUD
+
+/**
+ * USART1 link to the RN52.
+ *
+ * RX is written by DMA1 channel 5 into a circular buffer, so the CPU isn't
+ * interrupted per byte. The USART idle-line irq marks the end of a burst
+ * from the module and the DMA half/full-transfer irqs keep track of the
+ * write position between bursts. Data is consumed from the main loop a line
+ * at a time.
+ *
+ * TX is blocking, commands are only a few bytes long.
+ */
+class Rn52Link {
+public:
+    /// RN52 factory default
+    static constexpr uint32_t default_baud = 115200;
+    /// Negotiated by `BtModule` if RN52_FAST_BAUD, BRR error 0.2% at 24 MHz
+    static constexpr uint32_t fast_baud = 460800;
+
+    /// Must be a power of 2. Each half is 5.5 ms of data at `fast_baud`.
+    static constexpr uint16_t rx_buf_len = 512;
+    /// Longer lines are truncated
+    static constexpr uint16_t max_line_len = 128;
+
+    /// Called from irq context when new data has been received
+    using RxCallback = void (*)();
+
+    /// (Re)start the USART and RX DMA, discarding any buffered data
+    void start(uint32_t baud);
+
+    /**
+     * Change baud rate once pending TX has gone out, discarding any
+     * buffered data
+     */
+    void setBaud(uint32_t baud);
+    uint32_t baud() const
+    {
+        return baud_;
+    }
+
+    void setRxCallback(RxCallback callback)
+    {
+        rx_callback_ = callback;
+    }
+
+    /// Blocking write of a null terminated string
+    void write(const char* str);
+
+    /**
+     * Non-blocking. Get the next complete line, without the line ending.
+     * Empty lines are skipped.
+     *
+     * @param line null terminated, valid until the next call
+     * @return true if a line was available
+     */
+    bool readLine(const char*& line);
+
+    /**
+     * Non-blocking, zero-copy. Point `data` at the next contiguous run of
+     * unread bytes in the RX buffer. Use `consume` to mark them read.
+     *
+     * Not to be mixed with `readLine` part way through a line.
+     *
+     * @return number of bytes at `data`
+     */
+    uint16_t peek(const char*& data);
+    void consume(uint16_t n)
+    {
+        rx_read_ += n;
+    }
+
+    /**
+     * As `readLine`, but wait up to `timeout_ms` for a line to arrive
+     */
+    bool awaitLine(const char*& line, uint32_t timeout_ms);
+
+    /**
+     * Drop all received data, including any partial line
+     *
+     * @return number of bytes dropped
+     */
+    uint16_t discard();
+
+    /// Call from USART1 irq
+    void serviceUsartIrq();
+    /// Call from DMA1 channel 5 irq
+    void serviceDmaIrq();
+
+    /// Dump irq and error counts to the debug UART
+    void reportStats();
+
+private:
+    static_assert((rx_buf_len & (rx_buf_len - 1)) == 0, "rx_buf_len must be a power of 2");
+
+    uint8_t rx_buf_[rx_buf_len];
+
+    /// Bytes written by DMA / read by us since start. Only the difference
+    /// matters so wrapping is fine.
+    volatile uint32_t rx_written_ = 0;
+    uint32_t rx_read_ = 0;
+    /// DMA write position at the last update of `rx_written_`
+    volatile uint16_t dma_pos_ = 0;
+
+    RxCallback rx_callback_ = nullptr;
+    uint32_t baud_ = 0;
+
+    char line_[max_line_len + 1];
+    uint16_t line_len_ = 0;
+    bool line_truncated_ = false;
+
+    uint32_t n_usart_irqs_ = 0;
+    uint32_t n_dma_irqs_ = 0;
+    uint32_t n_bursts_ = 0;
+    /// USART overrun, DMA didn't read DR in time
+    uint32_t n_overruns_ = 0;
+    /// Buffer was lapped before we read it, data lost
+    uint32_t n_rx_overflows_ = 0;
+    uint32_t n_truncated_lines_ = 0;
+
+    /// Bring `rx_written_` up to the DMA write position. Irqs must be
+    /// disabled or be called from the RX irqs.
+    void updateWritePos();
+    /// From the RX irqs
+    void notifyRx();
+    /// @return bytes available to read
+    uint32_t available();
+};
+
+#endif /* SRC_DEVICES_RN52_LINK_H_ */
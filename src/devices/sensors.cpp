@@ -82,15 +82,19 @@ uint8_t clearProxInterrupt()
 static constexpr float m = 1.1187;
 static constexpr float c = -464.81;
 
-bool getTemp(EnvData& env_data, uint32_t secsActive)
+bool startTempMeasurement()
 {
-    // Trigger measure
-    bool success = bme280_.setMode(Bme280::Mode::forced);
-    if (!success)
-        return false;
+    return bme280_.setMode(Bme280::Mode::forced);
+}
 
-    delayMs(measure_time_ms);
-    success = bme280_.getMeasurements(env_data);
+uint16_t tempMeasureTimeMs()
+{
+    return measure_time_ms;
+}
+
+bool readTemp(EnvData& env_data, uint32_t secsActive)
+{
+    bool success = bme280_.getMeasurements(env_data);
 
     getErrHndlr().report("measured: %d\n", env_data.temperature);
 
@@ -132,7 +136,17 @@ uint8_t clearProxInterrupt()
     return 0;
 }
 
-bool getTemp(EnvData& env_data)
+bool startTempMeasurement()
+{
+    return true;
+}
+
+uint16_t tempMeasureTimeMs()
+{
+    return 0;
+}
+
+bool readTemp(EnvData& env_data, uint32_t secsActive)
 {
     static EnvData mock_data = {
         .pressure{1234},
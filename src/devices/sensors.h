@@ -31,13 +31,25 @@ uint16_t getProxCount();
 uint8_t clearProxInterrupt();
 
 /**
+ * Trigger a temperature/pressure/humidity measurement. Returns immediately,
+ * read the result with `readTemp` after `tempMeasureTimeMs`.
+ *
+ * @return true on success, false on failure
+ */
+bool startTempMeasurement();
+
+/// @return ms from `startTempMeasurement` until the result can be read
+uint16_t tempMeasureTimeMs();
+
+/**
+ * Read the result of the last measurement.
  *
  * @param env_data [out]
  * @param secsActive seconds elapsed since device woke
  *
- * @return
+ * @return true on success, false on failure
  */
-bool getTemp(EnvData& env_data, uint32_t secsActive);
+bool readTemp(EnvData& env_data, uint32_t secsActive);
 
 /**
  * @return ambient light level in millilux (0 -> 1,573,000)
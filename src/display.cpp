@@ -1,29 +1,129 @@
+#include <algorithm>
 #include "display.h"
 
 const Libp::RasterFont<32, 126>& Display::font_ = roboto_condensed_regular_14_2;
 
-/**
- * Update artist/track name text.
- *
- * @param artist [in,out] Null terminated artist name. length will be
- *                        reduced and "..." suffix added if required.
- * @param track  [in,out] Null terminated track name. length will be
- *                        reduced and "..." suffix added if required.
- */
-void Display::drawMetaText(char* artist, char* track)
+void Display::drawMetaField(TrackField field)
+{
+    if (!TrackInfo::hasText(field))
+        return;
+    char* text = track_info_.text(field);
+    const uint16_t row_y = field == TrackField::artist ? text_pos_y_row1 : text_pos_y_row2;
+
+    const uint16_t x_pos = Libp::enumBaseT(TextPos::now_playing);
+    const uint16_t available_width = meta_text_width;
+    const uint16_t top = row_y - text_row_offset_y;
+    const uint16_t row_height = 2 * text_row_offset_y;
+    text_painter_.trimText(font_, text, available_width);
+
+    // Just this row, the other may still be arriving
+    painter_.drawRectSolid(x_pos, top, available_width, row_height, 0x0);
+    text_painter_.drawText(x_pos, row_y, font_, text, Libp::Align::middle_left, text_colors);
+    flushRect(x_pos, top, available_width, row_height);
+}
+
+
+void Display::drawFeedback()
+{
+    painter_.drawRectSolid(feedback_x, feedback_y, feedback_w, feedback_h, 0x0);
+    switch (feedback_) {
+    case Feedback::none:
+        // Same position as the animations
+        painter_.drawBitmap(mgn_left, center_y, bt_connected_img, Libp::Align::middle_left);
+        break;
+    case Feedback::play_pause:
+        painter_.drawBitmap(feedback_x, feedback_y, btn_play_img, Libp::Align::top_left);
+        break;
+    case Feedback::next:
+        painter_.drawBitmap(feedback_x, feedback_y, btn_next_img, Libp::Align::top_left);
+        break;
+    case Feedback::prev:
+        painter_.drawBitmap(feedback_x, feedback_y, btn_prev_img, Libp::Align::top_left);
+        break;
+    case Feedback::vol_up:
+        painter_.drawBitmap(feedback_x, feedback_y, btn_vol_up_img, Libp::Align::top_left);
+        break;
+    case Feedback::vol_down:
+        painter_.drawBitmap(feedback_x, feedback_y, btn_vol_dn_img, Libp::Align::top_left);
+        break;
+    }
+}
+
+void Display::showVolume(uint8_t low, uint8_t high, uint8_t n_segments)
 {
-    const uint16_t available_width = end_text_x_pos - Libp::enumBaseT(TextPos::now_playing);
-    text_painter_.trimText(font_, artist, available_width);
-    text_painter_.trimText(font_, track, available_width);
-    drawText(TextPos::now_playing, artist, track);
+    if (menu_mode_)
+        return;
+    const bool was_shown = vol_n_segments_ != 0;
+    uint8_t first = n_segments;
+    uint8_t last = 0;
+    for (uint8_t seg = 0; seg < n_segments; seg++) {
+        const PixelType color = volSegColor(seg, low, high);
+        if (was_shown && color == volSegColor(seg, vol_low_, vol_high_))
+            continue;
+        painter_.drawRectSolid(vol_bar_x + seg * vol_seg_pitch, vol_bar_y, vol_seg_w, vol_bar_h, color);
+        first = std::min(first, seg);
+        last = seg;
+    }
+    vol_low_ = low;
+    vol_high_ = high;
+    vol_n_segments_ = n_segments;
+    // Usually a single segment for a single step
+    if (first <= last)
+        flushRect(vol_bar_x + first * vol_seg_pitch, vol_bar_y, (last - first + 1) * vol_seg_pitch, vol_bar_h);
 }
 
+void Display::hideVolume()
+{
+    if (vol_n_segments_ == 0)
+        return;
+    const uint16_t bar_w = vol_n_segments_ * vol_seg_pitch;
+    vol_n_segments_ = 0;
+    if (menu_mode_)
+        return;
+    painter_.drawRectSolid(vol_bar_x, vol_bar_y, bar_w, vol_bar_h, 0x0);
+    flushRect(vol_bar_x, vol_bar_y, bar_w, vol_bar_h);
+}
+
+void Display::showProgress(uint16_t filled)
+{
+    if (menu_mode_)
+        return;
+    filled = std::min(filled, progress_w);
+    if (progress_filled_ != progress_hidden && filled >= progress_filled_) {
+        if (filled == progress_filled_)
+            return;
+        // Usually a single column
+        const uint16_t x = progress_x + progress_filled_;
+        painter_.drawRectSolid(x, progress_y, filled - progress_filled_, progress_h, 0x0a);
+        flushRect(x, progress_y, filled - progress_filled_, progress_h);
+    }
+    else {
+        painter_.drawRectSolid(progress_x, progress_y, progress_w, progress_h, 0x02);
+        if (filled)
+            painter_.drawRectSolid(progress_x, progress_y, filled, progress_h, 0x0a);
+        flushRect(progress_x, progress_y, progress_w, progress_h);
+    }
+    progress_filled_ = filled;
+}
+
+void Display::hideProgress()
+{
+    if (progress_filled_ == progress_hidden)
+        return;
+    progress_filled_ = progress_hidden;
+    if (menu_mode_)
+        return;
+    painter_.drawRectSolid(progress_x, progress_y, progress_w, progress_h, 0x0);
+    flushRect(progress_x, progress_y, progress_w, progress_h);
+}
 
 void Display::drawText(TextPos pos, const char* line1, const char* line2)
 {
     const uint16_t x_pos = Libp::enumBaseT(pos);
     const uint16_t available_width = (pos == TextPos::fullscreen ? width : end_text_x_pos) - x_pos;
 
+    // Both clear the volume and progress bars
+    clearOverlays();
     if (pos == TextPos::fullscreen)
         disp_buffer_.fillScreen(0x0);
     else
@@ -167,6 +267,7 @@ void Display::drawAdjustClock(TimeData& time_data, ClockField highlight)
 void Display::drawMenu()
 {
     menu_mode_ = true;
+    clearOverlays();
 
     disp_buffer_.fillScreen(0x0);
     const uint16_t text_left_mgn = 6;
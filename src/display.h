@@ -7,6 +7,7 @@
 #include "graphics/display_buffer.h"
 
 #include "animation_render.h"
+#include "track_info.h"
 #include <error_handler.h>
 #include "app.h"
 
@@ -16,6 +17,19 @@
 #include "devices/rtc.h"
 #include "devices/sensors.h"
 
+/// Narrowest advance of the glyphs in `meta`
+template<size_t n>
+inline constexpr uint16_t minGlyphAdvance(const Libp::CharMeta (&meta)[n])
+{
+    uint16_t min_advance = UINT16_MAX;
+    for (const Libp::CharMeta& glyph : meta) {
+        const auto& [pos, size, offset, x_advance] = glyph;
+        if (x_advance < min_advance)
+            min_advance = x_advance;
+    }
+    return min_advance;
+}
+
 enum class ClockField : uint8_t {
     // DO NOT REORDER or assign values
     day_of_month,
@@ -74,6 +88,40 @@ public:
     static constexpr uint16_t end_text_x_pos = cat_pos_x - cat_text_mgn;
     static constexpr uint16_t main_text_width = cat_pos_x - text_pos_x_playing;
 
+    /// Width available to a metadata row
+    static constexpr uint16_t meta_text_width = end_text_x_pos - text_pos_x_playing;
+    /// Narrowest glyph in `font_`, roboto_condensed_regular_14_2
+    static constexpr uint16_t min_glyph_advance =
+            minGlyphAdvance(roboto_condensed_regular_14_2_meta_data);
+    /// Any more and the text is trimmed anyway. +1 so `trimText` can tell
+    /// that a truncated value didn't fit.
+    static constexpr uint16_t meta_text_max_chars = meta_text_width / min_glyph_advance + 1;
+    static_assert(TrackInfo::max_text_len == meta_text_max_chars);
+
+    /// Button feedback glyph drawn over the BT icon
+    static constexpr uint16_t feedback_x = mgn_left;
+    static constexpr uint16_t feedback_w = btn_play_img.width;
+    static constexpr uint16_t feedback_h = btn_play_img.height;
+    static constexpr uint16_t feedback_y = center_y - feedback_h / 2;
+    static_assert(feedback_x + feedback_w < text_pos_x_playing);
+
+    /// Volume bar below the track text, one segment per volume step
+    static constexpr uint16_t vol_bar_x = text_pos_x_playing;
+    static constexpr uint16_t vol_bar_y = text_pos_y_row2 + text_row_offset_y;
+    static constexpr uint16_t vol_bar_h = 3;
+    static constexpr uint16_t vol_seg_pitch = 8; ///< whole bytes, segments flush alone
+    static constexpr uint16_t vol_seg_w = vol_seg_pitch - 2;
+    static_assert(vol_bar_x % 2 == 0 && vol_seg_pitch % 2 == 0);
+    static_assert(vol_bar_y + vol_bar_h <= height);
+
+    /// Playback progress bar above the track text
+    static constexpr uint16_t progress_x = text_pos_x_playing;
+    static constexpr uint16_t progress_y = 1;
+    static constexpr uint16_t progress_w = 160;
+    static constexpr uint16_t progress_h = 2;
+    static_assert(progress_y + progress_h <= text_pos_y_row1 - text_row_offset_y);
+    static_assert(progress_x + progress_w < cat_pos_x - 6);
+
     enum class TextPos : uint16_t {
         fullscreen = width / 2,           ///< fullscreen centered
         now_playing = text_pos_x_playing, ///
@@ -82,6 +130,11 @@ public:
 
     using PixelType = uint8_t;
 
+    /// Local feedback for a button command, shown until the RN52 reacts
+    enum class Feedback : uint8_t {
+        none, play_pause, next, prev, vol_up, vol_down
+    };
+
     Display(Libp::IDrawingSurface<PixelType>& oled)
             : oled_(oled), painter_(disp_buffer_), text_painter_(disp_buffer_), anim_render_(painter_) { }
 
@@ -90,6 +143,8 @@ public:
     {
         if (!menu_mode_) {
             disp_buffer_.fillScreen(0x0);
+            feedback_ = Feedback::none;
+            clearOverlays();
             anim_render_.startAnimations(new_state, old_state);
             if (anim_render_.update())
                 flush();
@@ -102,11 +157,64 @@ public:
     void update()
     {
         if (!menu_mode_) {
-            if (anim_render_.update())
+            if (anim_render_.update()) {
+                // Animations redraw the BT icon
+                if (feedback_ != Feedback::none)
+                    drawFeedback();
                 flush();
+            }
         }
     }
 
+    /**
+     * Draw a feedback glyph over the BT icon and flush just that window.
+     * Replaced by the next module state change or `clearFeedback`.
+     */
+    void showFeedback(Feedback feedback)
+    {
+        feedback_ = feedback;
+        drawFeedback();
+        flushRect(feedback_x, feedback_y, feedback_w, feedback_h);
+    }
+
+    /// Restore the BT icon if feedback is showing
+    void clearFeedback()
+    {
+        if (feedback_ == Feedback::none)
+            return;
+        feedback_ = Feedback::none;
+        drawFeedback();
+        flushRect(feedback_x, feedback_y, feedback_w, feedback_h);
+    }
+
+    /**
+     * Show the volume bar: segments below `low` lit, up to `high` dimmed
+     * as the level is somewhere in between. Only segments that changed
+     * since the last call are redrawn and flushed.
+     *
+     * @param n_segments bar length, must not change while shown
+     */
+    void showVolume(uint8_t low, uint8_t high, uint8_t n_segments);
+    /// Clear the volume bar if it's showing
+    void hideVolume();
+
+    /**
+     * Show the progress bar with `filled` of `progress_w` pixels filled.
+     * If it's showing, only the newly filled columns are redrawn and
+     * flushed.
+     */
+    void showProgress(uint16_t filled);
+    /// Clear the progress bar if it's showing
+    void hideProgress();
+
+    /**
+     * @return ms until `update` next needs to be called, UINT32_MAX if never
+     */
+    uint32_t msToNextUpdate(uint32_t now_ms)
+    {
+        return menu_mode_ ? UINT32_MAX : anim_render_.msToNextUpdate(now_ms);
+    }
+
     /**
      * @return true if the disconnect animation has completed
      */
@@ -116,15 +224,17 @@ public:
     }
 
 
+    /// Metadata for the current track, written in place by the RN52 parser
+    TrackInfo& trackInfo()
+    {
+        return track_info_;
+    }
+
     /**
-     * Update artist/track name text.
-     *
-     * @param artist [in,out] Null terminated artist name. length will be
-     *                        reduced and "..." suffix added if required.
-     * @param track  [in,out] Null terminated track name. length will be
-     *                        reduced and "..." suffix added if required.
+     * Redraw the row for a `trackInfo` field, if it's shown. Text is
+     * shortened in place with a "..." suffix if required.
      */
-    void drawMetaText(char* artist, char* track);
+    void drawMetaField(TrackField field);
     void drawText(TextPos pos, const char* line1, const char* line2);
     void drawAdjustClock(TimeData& time_data, ClockField highlight);
 
@@ -144,6 +254,7 @@ public:
         constexpr uint16_t cat_stop_x  = cat_pos_x_clock + cat_wait_img.width;
         disp_buffer_.fillRect(0, 0, cat_start_x, height, 0);
         disp_buffer_.fillRect(cat_stop_x, 0, width - cat_stop_x, height, 0);
+        clearOverlays();
 
         drawClock(date_time, false);
         drawWeather(env_data);
@@ -180,11 +291,50 @@ private:
     /// Normal animations don't draw in menu mode
     bool menu_mode_ = false;
 
+    TrackInfo track_info_ = {};
+
+    Feedback feedback_ = Feedback::none;
+    /// Draw feedback glyph or BT icon if none
+    void drawFeedback();
+
+    /// Volume bar as last drawn, n_segments is 0 if hidden
+    uint8_t vol_low_ = 0;
+    uint8_t vol_high_ = 0;
+    uint8_t vol_n_segments_ = 0;
+    PixelType volSegColor(uint8_t seg, uint8_t low, uint8_t high) const
+    {
+        return seg < low ? 0x0f : seg < high ? 0x06 : 0x02;
+    }
+
+    static constexpr uint16_t progress_hidden = UINT16_MAX;
+    /// Filled width as last drawn
+    uint16_t progress_filled_ = progress_hidden;
+
+    /// Volume and progress bars were drawn over
+    void clearOverlays()
+    {
+        vol_n_segments_ = 0;
+        progress_filled_ = progress_hidden;
+    }
+
     /// Flush display buffer to OLED
     void flush()
     {
         oled_.copyRect(0, 0, width, height, disp_buffer_.buffer());
     }
+
+    /**
+     * Flush a window of the display buffer to the OLED, row by row straight
+     * from the buffer. x/w are widened to whole bytes (2 pixels).
+     */
+    void flushRect(uint16_t x, uint16_t y, uint16_t w, uint16_t h)
+    {
+        const uint16_t x0 = x & ~1u;
+        const uint16_t x1 = (x + w + 1) & ~1u;
+        const auto buf = disp_buffer_.buffer();
+        for (uint16_t row = y; row < y + h; row++)
+            oled_.copyRect(x0, row, x1 - x0, 1, buf + (row * width + x0) / 2);
+    }
 };
 
 #endif /* SRC_DISPLAY_H_ */
@@ -0,0 +1,82 @@
+#ifndef SRC_EVENT_PAYLOAD_H_
+#define SRC_EVENT_PAYLOAD_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include "error_handler.h"
+
+/// RN52 SSP pairing passkey (6 ASCII digits, not terminated)
+struct Passkey {
+    char digits[6];
+};
+
+/**
+ * Fixed pool of statically allocated payload blocks that events can carry a
+ * handle to.
+ *
+ * A producer allocates a block, fills it in place and posts the handle with
+ * the event. The consumer reads the block in place and releases it. The
+ * payload type is implied by the event type.
+ *
+ * `alloc` and `release` are lock-free and can be called from irq handlers.
+ */
+class PayloadPool {
+public:
+    using Handle = uint8_t;
+    static constexpr Handle no_payload = 0xff;
+
+    /**
+     * @return handle to a free block or `no_payload` if the pool is exhausted
+     */
+    Handle alloc()
+    {
+        uint8_t used = used_mask_;
+        Handle idx;
+        do {
+            if (used == all_used) {
+                n_exhausted_++;
+                return no_payload;
+            }
+            idx = __builtin_ctz(~used);
+        } while (!used_mask_.compare_exchange_weak(used, used | (1u << idx)));
+
+        const uint8_t n_used = __builtin_popcount(used) + 1;
+        if (n_used > high_water_)
+            high_water_ = n_used;
+        return idx;
+    }
+
+    void release(Handle handle)
+    {
+        if (handle != no_payload)
+            used_mask_.fetch_and(~(1u << handle));
+    }
+
+    template <typename T>
+    T& get(Handle handle)
+    {
+        static_assert(sizeof(T) <= block_size && alignof(T) <= block_align);
+        return *reinterpret_cast<T*>(blocks_[handle]);
+    }
+
+    void reportStats()
+    {
+        getErrHndlr().report("Payload pool: %d/%d high water, %d exhausted\r\n",
+                high_water_, n_blocks, static_cast<int>(n_exhausted_));
+    }
+
+private:
+    static constexpr uint8_t n_blocks = 2;
+    static constexpr uint8_t all_used = (1u << n_blocks) - 1;
+    /// `Passkey` is the only payload, sensor readings aren't posted
+    static constexpr size_t block_size = sizeof(Passkey);
+    static constexpr size_t block_align = 4;
+
+    alignas(block_align) uint8_t blocks_[n_blocks][block_size];
+    std::atomic<uint8_t> used_mask_ = 0;
+    uint8_t high_water_ = 0;
+    std::atomic<uint16_t> n_exhausted_ = 0;
+};
+
+#endif /* SRC_EVENT_PAYLOAD_H_ */
@@ -3,20 +3,32 @@
 
 #include <cstdint>
 #include <atomic>
+#include <libpekin.h>
 #include "app.h"
+#include "cycle_counter.h"
 #include "error_handler.h"
-#include "devices/peripherals.h"
+#include "event_payload.h"
+#include <devices/peripherals.h>
 
 enum class EventType {
     do_nothing_event,
     proximity_trigger,
     clock_tick,
     rn52_gpio2,
+    inactivity_timeout,
     rn52_state_chg,
     track_chg,
     btn_play, btn_next, btn_prev, btn_vol_up, btn_vol_dn,
     btn_play_release,
-    btn_play_long_press
+    btn_play_long_press,
+    rn52_rx,
+    rn52_status,
+    rn52_meta_field,
+    rn52_metadata,
+    rn52_track_event,
+    rn52_vol_event,
+    rn52_profile_chg,
+    rn52_passkey     ///< payload: `Passkey`
 };
 
 /// labels for serial debugging
@@ -25,20 +37,61 @@ inline const char* event_type_names[] = {
     "proximity_trigger",
     "clock_tick",
     "rn52_gpio2",
+    "inactivity_timeout",
     "rn52_state_chg",
     "track_chg",
     "btn_play", "btn_next", "btn_prev", "btn_vol_up", "btn_vol_dn",
     "btn_play_release",
-    "btn_play_long_press"
+    "btn_play_long_press",
+    "rn52_rx",
+    "rn52_status",
+    "rn52_meta_field",
+    "rn52_metadata",
+    "rn52_track_event",
+    "rn52_vol_event",
+    "rn52_profile_chg",
+    "rn52_passkey"
 };
 
-/// Message queue to receive irq events.
-/// e.g. RN52 events, button presses, proximity etc.
+inline constexpr uint8_t n_event_types = sizeof(event_type_names) / sizeof(event_type_names[0]);
+
+/**
+ * Events for which only the fact that something happened matters, not how
+ * many times. These bypass the FIFO and are coalesced into a pending bit so
+ * an irq storm can't crowd out button presses.
+ */
+inline constexpr bool isCoalescable(EventType type)
+{
+    return type == EventType::proximity_trigger
+        || type == EventType::clock_tick
+        || type == EventType::rn52_gpio2
+        || type == EventType::inactivity_timeout
+        || type == EventType::rn52_rx
+        || type == EventType::rn52_status
+        || type == EventType::rn52_meta_field
+        || type == EventType::rn52_track_event
+        || type == EventType::rn52_vol_event
+        || type == EventType::rn52_profile_chg;
+}
+
+/**
+ * Message queue to receive irq events.
+ * e.g. RN52 events, button presses, proximity etc.
+ *
+ * Two channels:
+ *  - a FIFO for events where order and count matter (buttons, state changes)
+ *  - a pending bitmask for coalescable events (see `isCoalescable`)
+ *
+ * FIFO events are always dispatched first. Pending bits are dispatched once
+ * the FIFO is empty, in ascending `EventType` order.
+ */
 class EventQueue {
 public:
     struct Event {
         EventType event_;
         ModuleState new_state_;
+        PayloadPool::Handle payload_; ///< released by the dispatcher
+        uint32_t post_cycles_;        ///< `cycleCount()` at post time
     };
 
     // NOTE: reentrant
@@ -48,10 +101,18 @@ public:
      *
      * @param type
      * @param new_state only used if type == EventType::rn52_state_chg
+     * @param payload block from `payloads()`, ownership passes to the queue.
+     *                Not supported for coalescable events.
      */
-    void postEvent(EventType type, ModuleState new_state = ModuleState::disconnected)
+    void postEvent(EventType type, ModuleState new_state = ModuleState::disconnected,
+            PayloadPool::Handle payload = PayloadPool::no_payload)
     {
         getErrHndlr().report("EQ: postEvent (%s)\r\n", event_type_names[Libp::enumBaseT(type)]);
+        if (isCoalescable(type)) {
+            payloads_.release(payload);
+            postFlag(type);
+            return;
+        }
         // This function is called by the irq handlers and the main program
         // loop. Interrupts are all the same priority and so can't interrupt
         // each other, but an interrupt could interrupt calls from the main
@@ -62,10 +123,14 @@ public:
         // cleared before enabling).
         //
         disableExtIrqs();
-        if (n_pending_events_ == queue_length)
+        if (n_pending_events_ == queue_length) {
             // queue full - should we halt here instaed of dropping events?
+            n_dropped_++;
+            payloads_.release(payload);
+            enableExtIrqs();
             return;
-        pending_events_[write_idx_++] = { type, new_state };
+        }
+        pending_events_[write_idx_++] = { type, new_state, payload, cycleCount() };
         if (write_idx_ == queue_length)
             write_idx_ = 0;
         n_pending_events_++;
@@ -74,14 +139,15 @@ public:
 
     bool eventIsPending()
     {
-        return n_pending_events_ > 0;
+        return n_pending_events_ > 0 || pending_flags_ != 0;
     }
 
     Event getNextPendingEvent()
     {
-        disableExtIrqs();
         if (n_pending_events_ == 0)
-            return { EventType::do_nothing_event, ModuleState::disconnected };
+            return takeFlag();
+
+        disableExtIrqs();
         // Copy with interrupts disabled to ensure
         // no partial overwrite while returning a copy
         Event event_copy = pending_events_[read_idx_++];
@@ -92,12 +158,79 @@ public:
         return event_copy;
     }
 
+    /// Payload blocks for events that carry data
+    PayloadPool& payloads()
+    {
+        return payloads_;
+    }
+
+    /// Posts discarded because the FIFO was full
+    uint16_t nDropped() const
+    {
+        return n_dropped_;
+    }
+    /// Posts of `type` merged into an already pending bit
+    uint16_t nCoalesced(EventType type) const
+    {
+        return n_coalesced_[Libp::enumBaseT(type)];
+    }
+
+    /// Print dropped/coalesced event counts to the debug UART
+    void reportStats()
+    {
+        payloads_.reportStats();
+        getErrHndlr().report("EQ: %d dropped\r\n", static_cast<int>(n_dropped_));
+        for (uint8_t i = 0; i < n_event_types; i++) {
+            if (isCoalescable(static_cast<EventType>(i)))
+                getErrHndlr().report("EQ: %s coalesced %d\r\n",
+                        event_type_names[i], static_cast<int>(n_coalesced_[i]));
+        }
+    }
+
 private:
     static constexpr uint8_t queue_length = 5;
     Event pending_events_[queue_length];
     std::atomic<uint8_t> write_idx_ = 0;
     uint8_t read_idx_ = 0;
     std::atomic<uint8_t> n_pending_events_ = 0;
+
+    PayloadPool payloads_;
+
+    /// One bit per coalescable `EventType`
+    std::atomic<uint32_t> pending_flags_ = 0;
+    static_assert(n_event_types <= 32);
+
+    /// Time of the first (oldest) post for each pending bit
+    uint32_t flag_post_cycles_[n_event_types];
+
+    /// Posts discarded because the FIFO was full
+    uint16_t n_dropped_ = 0;
+    /// Posts merged into an already pending bit
+    std::atomic<uint16_t> n_coalesced_[n_event_types] = {};
+
+    /// Lock-free - safe from irq handlers and the main loop (LDREX/STREX)
+    void postFlag(EventType type)
+    {
+        const uint8_t idx = Libp::enumBaseT(type);
+        const uint32_t bit = 1ul << idx;
+        // Only a main loop post interrupted by an irq posting the same type
+        // can race here, which costs at worst one skewed latency sample.
+        if (!(pending_flags_ & bit))
+            flag_post_cycles_[idx] = cycleCount();
+        if (pending_flags_.fetch_or(bit) & bit)
+            n_coalesced_[idx]++;
+    }
+
+    Event takeFlag()
+    {
+        const uint32_t flags = pending_flags_;
+        if (flags == 0)
+            return { EventType::do_nothing_event, ModuleState::disconnected, PayloadPool::no_payload, cycleCount() };
+        const uint8_t idx = __builtin_ctz(flags);
+        const uint32_t post_cycles = flag_post_cycles_[idx];
+        pending_flags_.fetch_and(~(1ul << idx));
+        return { static_cast<EventType>(idx), ModuleState::disconnected, PayloadPool::no_payload, post_cycles };
+    }
 };
 
 #endif /* SRC_EVENT_QUEUE_H_ */
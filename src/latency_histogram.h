@@ -0,0 +1,48 @@
+#ifndef SRC_LATENCY_HISTOGRAM_H_
+#define SRC_LATENCY_HISTOGRAM_H_
+
+#include <cstdint>
+#include <error_handler.h>
+
+/**
+ * log2 histogram of durations in microseconds.
+ *
+ * Bucket n counts durations in [2^(n-1), 2^n) us, with bucket 0 holding
+ * durations < 1us and the last bucket holding everything above its range.
+ */
+class LatencyHistogram {
+public:
+    static constexpr uint8_t n_buckets = 20; // last bucket >= ~262ms
+
+    void record(uint32_t us)
+    {
+        uint8_t bucket = us == 0 ? 0 : 32 - __builtin_clz(us);
+        if (bucket >= n_buckets)
+            bucket = n_buckets - 1;
+        if (counts_[bucket] != UINT16_MAX)
+            counts_[bucket]++;
+        if (us > worst_us_)
+            worst_us_ = us;
+        n_++;
+    }
+
+    uint32_t count() const { return n_; }
+    uint32_t worstUs() const { return worst_us_; }
+
+    /// Print non-empty buckets to the debug UART
+    void report(const char* label) const
+    {
+        getErrHndlr().report("%s: n=%lu worst=%luus\r\n", label, n_, worst_us_);
+        for (uint8_t i = 0; i < n_buckets; i++) {
+            if (counts_[i])
+                getErrHndlr().report("  <%luus: %u\r\n", 1ul << i, counts_[i]);
+        }
+    }
+
+private:
+    uint16_t counts_[n_buckets] = {};
+    uint32_t worst_us_ = 0;
+    uint32_t n_ = 0;
+};
+
+#endif /* SRC_LATENCY_HISTOGRAM_H_ */
@@ -4,9 +4,12 @@
 #include "clock_stm32f1xx.h"
 
 #include <bt_module.h>
+#include <button_service.h>
+#include <cycle_counter.h>
 #include <error_handler.h>
 #include <event_queue.h>
 #include <player_state_machine.h>
+#include <stack_watermark.h>
 
 #include <devices/peripherals.h>
 #include <devices/rn52.h>
@@ -23,10 +26,11 @@ brown/black/blue cable
 using namespace Libp;
 using namespace LibpStm32;
 
-static BtModule bt_module_(getRn52());
+static EventQueue queue_;
+static BtModule bt_module_(getRn52Link(), queue_);
 static Display display(getOled());
 static PwrControl pwr_ctrl;
-static EventQueue queue_;
+static ButtonService buttons_(queue_);
 static PlayerStateMachine player(queue_, bt_module_, display, pwr_ctrl);
 
 void initSysClock()
@@ -98,7 +102,9 @@ void initPeripherals()
 
 int main(void)
 {
+    paintStack();
     initSysClock();
+    initCycleCounter();
     libpekinInitTimers();
     initPeripherals();
     pwr_ctrl.setState(PwrControl::PwrState::clock); // needs errHndlr
@@ -108,6 +114,9 @@ int main(void)
     drawProx();
 #endif
     initRn52();
+    getRn52Link().setRxCallback([]() {
+        queue_.postEvent(EventType::rn52_rx);
+    });
     if (!bt_module_.init()) {
         getErrHndlr().halt(ErrorCode::module_init_fail, "BT init failed");
     }
@@ -135,34 +144,46 @@ void EXTI15_10_IRQHandler(void)
     }
 
     // --- Button events ---
+    // Debounced by sampling from TIM3, any edge just starts the sampling.
 
+    bool btn_edge = false;
     if (Pins::btn_play.irqIsPending()) {
-        bool pressed = Pins::btn_play.read();
-        getErrHndlr().report("Play: %d\r\n", (int)pressed);
-        queue_.postEvent(pressed ? EventType::btn_play : EventType::btn_play_release);
+        btn_edge = true;
         Pins::btn_play.clearPendingIrqBit();
     }
     if (Pins::btn_vol_up.irqIsPending()) {
-        queue_.postEvent(EventType::btn_vol_up);
+        btn_edge = true;
         Pins::btn_vol_up.clearPendingIrqBit();
     }
     if (Pins::btn_vol_dn.irqIsPending()) {
-        queue_.postEvent(EventType::btn_vol_dn);
+        btn_edge = true;
         Pins::btn_vol_dn.clearPendingIrqBit();
     }
     if (Pins::btn_next.irqIsPending()) {
-        queue_.postEvent(EventType::btn_next);
+        btn_edge = true;
         Pins::btn_next.clearPendingIrqBit();
     }
     if (Pins::btn_prev.irqIsPending()) {
-        queue_.postEvent(EventType::btn_prev);
+        btn_edge = true;
         Pins::btn_prev.clearPendingIrqBit();
     }
+    if (btn_edge && buttons_.notifyEdge())
+        startBtnSampleTimer();
     Pins::btn_prev.clearPendingIrqLine();
     //__DSB();
     enableExtIrqs();
 }
 
+/// Button sample timer
+__attribute__ ((interrupt("IRQ")))
+void TIM3_IRQHandler(void)
+{
+    TIM3->SR = ~TIM_SR_UIF;
+    if (!buttons_.sample(readBtnLevels()))
+        stopBtnSampleTimer();
+    __DSB();
+}
+
 /// Triggered by RTC minute tick
 __attribute__ ((interrupt("IRQ")))
 void EXTI9_5_IRQHandler(void)
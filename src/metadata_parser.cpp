@@ -0,0 +1,152 @@
+#include <cstring>
+#include <metadata_parser.h>
+
+namespace {
+
+struct Key {
+    const char* name;
+    TrackField field;
+};
+
+constexpr Key keys[] = {
+    { "Title",       TrackField::title },
+    { "Artist",      TrackField::artist },
+    { "Album",       TrackField::album },
+    { "TrackNumber", TrackField::track_number },
+    { "TrackCount",  TrackField::track_count },
+    { "Genre",       TrackField::genre },
+    { "Time(ms)",    TrackField::duration },
+};
+static_assert(sizeof(keys) / sizeof(keys[0]) == n_track_fields);
+
+}
+
+void MetadataParser::begin(TrackInfo& dest)
+{
+    dest = {};
+    dest_ = &dest;
+    startLine();
+}
+
+void MetadataParser::startLine()
+{
+    state_ = State::key;
+    key_len_ = 0;
+    utf8_.reset();
+}
+
+MetadataParser::Result MetadataParser::feed(char c)
+{
+    if (c == '\r')
+        return Result::none;
+
+    switch (state_) {
+    case State::key:
+        if (c == '\n')
+            return endOfKeyLine();
+        if (c == '=') {
+            key_[key_len_] = '\0';
+            key_len_ = 0;
+            startValue();
+        }
+        else if (key_len_ < max_key_len)
+            key_[key_len_++] = c;
+        else
+            state_ = State::skip_line;
+        break;
+
+    case State::text_value: {
+        if (c == '\n')
+            return endOfValue();
+        const uint32_t code_point = utf8_.feed(c);
+        if (code_point == Utf8Decoder::none)
+            break;
+        // Printable ASCII as is, control characters and DEL (also as
+        // overlong forms) are transliterated to "?"
+        if (code_point >= 0x20 && code_point < 0x7f) {
+            const char ascii[] = { static_cast<char>(code_point), '\0' };
+            appendText(ascii);
+        }
+        else
+            appendText(transliterate(code_point));
+        break;
+    }
+
+    case State::number_value:
+        if (c == '\n')
+            return endOfValue();
+        if (c >= '0' && c <= '9')
+            number_ = number_ * 10 + (c - '0');
+        break;
+
+    case State::skip_line:
+        if (c == '\n')
+            startLine();
+        break;
+    }
+    return Result::none;
+}
+
+void MetadataParser::startValue()
+{
+    for (const Key& key : keys) {
+        if (strcmp(key_, key.name) != 0)
+            continue;
+        field_ = key.field;
+        number_ = 0;
+        utf8_.reset();
+        switch (field_) {
+        case TrackField::title:
+        case TrackField::artist:
+            dest_->beginText(field_);
+            break;
+        case TrackField::album:
+        case TrackField::genre:
+            state_ = State::skip_line;
+            return;
+        case TrackField::track_number:
+        case TrackField::track_count:
+        case TrackField::duration:
+            state_ = State::number_value;
+            return;
+        }
+        state_ = State::text_value;
+        return;
+    }
+    state_ = State::skip_line;
+}
+
+MetadataParser::Result MetadataParser::endOfKeyLine()
+{
+    // A line without '=', "AOK" or an error
+    key_[key_len_] = '\0';
+    startLine();
+    if (strncmp(key_, "ERR", 3) == 0 || key_[0] == '?')
+        return Result::error;
+    return Result::none;
+}
+
+void MetadataParser::appendText(const char* ascii)
+{
+    for (; *ascii; ascii++)
+        dest_->appendText(*ascii);
+}
+
+MetadataParser::Result MetadataParser::endOfValue()
+{
+    startLine();
+    switch (field_) {
+    case TrackField::track_number: dest_->track_number = number_; break;
+    case TrackField::track_count:  dest_->track_count = number_;  break;
+    case TrackField::duration:
+        dest_->duration_ms = number_;
+        return Result::end;
+    case TrackField::title:
+    case TrackField::artist:
+        dest_->endText();
+        break;
+    default:
+        break;
+    }
+    return Result::field_done;
+}
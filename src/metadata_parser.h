@@ -0,0 +1,75 @@
+#ifndef SRC_METADATA_PARSER_H_
+#define SRC_METADATA_PARSER_H_
+
+#include <cstdint>
+#include <track_info.h>
+#include <utf8.h>
+
+/**
+ * Streaming parser for the RN52 "AD" response:
+ *
+ *     AOK
+ *     Title=...
+ *     Artist=...
+ *     Album=...
+ *     TrackNumber=...
+ *     TrackCount=...
+ *     Genre=...
+ *     Time(ms)=...
+ *
+ * Fed a byte at a time straight from the RX buffer. Text values are
+ * written directly into the destination `TrackInfo`, so each field can be
+ * used as soon as its line ends. Fields the phone doesn't send are left
+ * empty/0. Album and genre aren't stored.
+ *
+ * Text arrives as UTF-8 and is stored as ASCII, the only characters the
+ * font has: other characters are transliterated.
+ */
+class MetadataParser {
+public:
+    enum class Result : uint8_t {
+        none,       ///< need more data
+        field_done, ///< `lastField` is complete
+        end,        ///< Time(ms), the last field, is complete
+        error,      ///< module replied ERR or ?
+    };
+
+    /// Clear `dest` and start a new response
+    void begin(TrackInfo& dest);
+
+    Result feed(char c);
+
+    TrackField lastField() const
+    {
+        return field_;
+    }
+
+private:
+    /// Longest key, "TrackNumber"
+    static constexpr uint8_t max_key_len = 11;
+
+    enum class State : uint8_t {
+        key, text_value, number_value, skip_line
+    };
+
+    TrackInfo* dest_ = nullptr;
+    State state_ = State::key;
+
+    char key_[max_key_len + 1];
+    uint8_t key_len_ = 0;
+
+    TrackField field_ = TrackField::title;
+    Utf8Decoder utf8_;
+    uint32_t number_ = 0;
+
+    /// Every line starts from a clean key and decoder, whatever the
+    /// previous line held
+    void startLine();
+    /// Select the value destination for the key just ended
+    void startValue();
+    Result endOfKeyLine();
+    Result endOfValue();
+    void appendText(const char* ascii);
+};
+
+#endif /* SRC_METADATA_PARSER_H_ */
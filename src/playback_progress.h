@@ -0,0 +1,83 @@
+#ifndef SRC_PLAYBACK_PROGRESS_H_
+#define SRC_PLAYBACK_PROGRESS_H_
+
+#include <cstdint>
+
+/**
+ * Playback position of the current track, interpolated from the time
+ * spent streaming since the track changed. The RN52 only reports the
+ * track duration, so the position is never queried.
+ *
+ * Starts paused with an unknown (0) duration.
+ */
+class PlaybackProgress {
+public:
+    static constexpr uint32_t never = UINT32_MAX;
+
+    /// Track changed, restart from 0 keeping the play/pause state
+    void restart(uint32_t now_ms)
+    {
+        played_ms_ = 0;
+        resumed_ms_ = now_ms;
+        duration_ms_ = 0;
+    }
+
+    void setDuration(uint32_t duration_ms)
+    {
+        duration_ms_ = duration_ms;
+    }
+    bool hasDuration() const
+    {
+        return duration_ms_ != 0;
+    }
+
+    void resume(uint32_t now_ms)
+    {
+        if (playing_)
+            return;
+        playing_ = true;
+        resumed_ms_ = now_ms;
+    }
+    void pause(uint32_t now_ms)
+    {
+        if (!playing_)
+            return;
+        played_ms_ = positionMs(now_ms);
+        playing_ = false;
+    }
+
+    uint32_t positionMs(uint32_t now_ms) const
+    {
+        uint32_t pos = played_ms_;
+        if (playing_)
+            pos += now_ms - resumed_ms_;
+        return hasDuration() && pos > duration_ms_ ? duration_ms_ : pos;
+    }
+
+    /// @return pixels of a `width` wide bar that are filled
+    uint16_t filledWidth(uint32_t now_ms, uint16_t width) const
+    {
+        if (!hasDuration())
+            return 0;
+        return uint64_t(positionMs(now_ms)) * width / duration_ms_;
+    }
+
+    /// @return ms until `filledWidth` grows, or `never` if it won't
+    uint32_t msToNextPixel(uint32_t now_ms, uint16_t width) const
+    {
+        const uint16_t filled = filledWidth(now_ms, width);
+        if (!playing_ || !hasDuration() || filled >= width)
+            return never;
+        // First ms at which the next pixel is filled, rounded up
+        const uint32_t next_ms = (uint64_t(filled + 1) * duration_ms_ + width - 1) / width;
+        return next_ms - positionMs(now_ms);
+    }
+
+private:
+    uint32_t played_ms_ = 0;  ///< up to the last pause
+    uint32_t resumed_ms_ = 0;
+    uint32_t duration_ms_ = 0;
+    bool playing_ = false;
+};
+
+#endif /* SRC_PLAYBACK_PROGRESS_H_ */
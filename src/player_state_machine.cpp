@@ -1,3 +1,5 @@
+#include <algorithm>
+#include <initializer_list>
 #include <event_queue.h>
 #include <devices/peripherals.h>
 #include <devices/haptic.h>
@@ -5,71 +7,206 @@
 #include <devices/sensors.h>
 #include <display.h>
 #include <player_state_machine.h>
+#include <stack_watermark.h>
 
 using namespace Libp;
 
 PlayerStateMachine::PlayerStateMachine(EventQueue& event_queue,
         BtModule& bt_module, Display& display, PwrControl& pwr_ctrl)
             : event_queue_(event_queue), bt_module_(bt_module),
-              display_(display), pwr_ctrl_(pwr_ctrl) { }
+              display_(display), pwr_ctrl_(pwr_ctrl), timers_(event_queue)
+{
+    timers_.setCallback(TimerId::animation, [](void* ctx) {
+        static_cast<PlayerStateMachine*>(ctx)->handleAnimationTimer();
+    }, this);
+    timers_.setCallback(TimerId::brightness, [](void* ctx) {
+        StageProfiler::Scope scope(static_cast<PlayerStateMachine*>(ctx)->profiler_, Stage::brightness);
+        oledUpdateBrightness( getLightLvl() );
+    }, this);
+    timers_.setCallback(TimerId::stats_window, [](void* ctx) {
+        auto self = static_cast<PlayerStateMachine*>(ctx);
+        self->loop_passes_per_min_ = self->n_loop_passes_;
+        self->n_loop_passes_ = 0;
+    }, this);
+    timers_.setCallback(TimerId::sensor_read, [](void* ctx) {
+        static_cast<PlayerStateMachine*>(ctx)->handleSensorRead();
+    }, this);
+    timers_.setCallback(TimerId::menu_message, [](void* ctx) {
+        static_cast<PlayerStateMachine*>(ctx)->exitMenuMode();
+    }, this);
+    timers_.setCallback(TimerId::rn52_boot, [](void* ctx) {
+        static_cast<PlayerStateMachine*>(ctx)->handleRn52BootPoll();
+    }, this);
+    timers_.setCallback(TimerId::feedback, [](void* ctx) {
+        // No confirmation from the RN52, the command had no effect
+        static_cast<PlayerStateMachine*>(ctx)->clearFeedback();
+    }, this);
+    timers_.setCallback(TimerId::skip_burst, [](void* ctx) {
+        static_cast<PlayerStateMachine*>(ctx)->handleSkipBurst();
+    }, this);
+    timers_.setEvent(TimerId::track_settle, EventType::track_chg);
+    timers_.setCallback(TimerId::progress, [](void* ctx) {
+        static_cast<PlayerStateMachine*>(ctx)->updateProgress();
+    }, this);
+    timers_.setCallback(TimerId::volume_bar, [](void* ctx) {
+        static_cast<PlayerStateMachine*>(ctx)->display_.hideVolume();
+    }, this);
+    timers_.setCallback(TimerId::rn52_cmd, [](void* ctx) {
+        static_cast<PlayerStateMachine*>(ctx)->bt_module_.poll(getMillis());
+    }, this);
+    timers_.setEvent(TimerId::inactivity, EventType::inactivity_timeout);
+}
 
 // Main program loop
 void PlayerStateMachine::run()
 {
-    pwr_ctrl_.resetInactivityTimer();
+    resetInactivityTimer();
+    timers_.startPeriodic(TimerId::brightness, oled_brightness_period_ms);
+    timers_.startPeriodic(TimerId::stats_window, 60'000);
     display_.notifyNewModuleState(ModuleState::disconnected, ModuleState::disconnected);
     event_queue_.postEvent(EventType::clock_tick); // paint clock
     while (true) {
+        n_loop_passes_++;
 
-        while(event_queue_.eventIsPending())
-            processEvent(event_queue_.getNextPendingEvent());
-
-        // Flag set by transition to disconnected state.
-        // Need to wait on disconnect animation if we were previously connected
-        if (draw_clock_when_display_ready_ && display_.disconnectAnimIsDone() ) {
-            draw_clock_when_display_ready_ = false;
-            // Start clock animation
-            display_.notifyNewModuleState(ModuleState::disconnected, ModuleState::disconnected);
-            event_queue_.postEvent(EventType::clock_tick);
-        }
-        // Detect long press of play button
-        if (last_play_press_ms) {
-            static constexpr uint32_t long_press_duration_ms = 2000;
-            uint32_t now_ms = getMillis();
-            if ( (now_ms - last_play_press_ms) > long_press_duration_ms) {
-                event_queue_.postEvent(EventType::btn_play_long_press);
-                last_play_press_ms = 0;
-            }
+        while(event_queue_.eventIsPending()) {
+            EventQueue::Event event = event_queue_.getNextPendingEvent();
+            StageProfiler::Scope scope(profiler_, Stage::process_event);
+            processEvent(event);
+            event_queue_.payloads().release(event.payload_);
         }
 
-        if (player_state_ == PlayerState::pairing_listening)
-            handlePairingModeListening();
+        timers_.processExpired(getMillis());
 
-        display_.update();
-        oledUpdateBrightness( getLightLvl() );
-        sleepIfInactive();
+        // Events may have started new animations or RN52 commands
+        scheduleAnimationTimer();
+        scheduleRn52Timer();
 
-        delayMs(5);
+        // Sleep until the next timer expiry or event
+        StageProfiler::Scope scope(profiler_, Stage::idle);
+        waitForEvent(timers_.msToNextExpiry(getMillis()));
     }
 }
 
-static uint32_t lastWakeTime = 0;
-
-void PlayerStateMachine::sleepIfInactive()
+void PlayerStateMachine::handleAnimationTimer()
 {
-    if (module_state_ == ModuleState::disconnected && pwr_ctrl_.timeToSleep()) {
-        player_state_ = PlayerState::normal;
-        pwr_ctrl_.sleep();
-        lastWakeTime = getMillis();
+    StageProfiler::Scope scope(profiler_, Stage::display_update);
+    display_.update();
+
+    // Flag set by transition to disconnected state.
+    // Need to wait on disconnect animation if we were previously connected
+    if (draw_clock_when_display_ready_ && display_.disconnectAnimIsDone() ) {
+        draw_clock_when_display_ready_ = false;
+        // Start clock animation
+        display_.notifyNewModuleState(ModuleState::disconnected, ModuleState::disconnected);
         event_queue_.postEvent(EventType::clock_tick);
     }
 }
 
+void PlayerStateMachine::scheduleAnimationTimer()
+{
+    const uint32_t ms = display_.msToNextUpdate(getMillis());
+    if (ms == UINT32_MAX)
+        timers_.stop(TimerId::animation);
+    else
+        timers_.startOneShot(TimerId::animation, ms);
+}
+
+void PlayerStateMachine::scheduleRn52Timer()
+{
+    const uint32_t ms = bt_module_.msToDeadline(getMillis());
+    if (ms == Rn52CmdEngine::never)
+        timers_.stop(TimerId::rn52_cmd);
+    else
+        timers_.startOneShot(TimerId::rn52_cmd, ms);
+}
+
+void PlayerStateMachine::resetInactivityTimer()
+{
+    timers_.startOneShot(TimerId::inactivity, PwrControl::inactivity_sleep_time_ms);
+}
+
+void PlayerStateMachine::waitForEvent(uint32_t timeout_ms)
+{
+    const uint32_t start_ms = getMillis();
+    while (getMillis() - start_ms < timeout_ms) {
+        // WFI still wakes on a pending irq with PRIMASK set, so an event
+        // posted between the check and the WFI can't be missed. The irq is
+        // serviced as soon as PRIMASK is cleared.
+        __disable_irq();
+        if (event_queue_.eventIsPending()) {
+            __enable_irq();
+            return;
+        }
+        __WFI();
+        __enable_irq();
+    }
+}
+
+void PlayerStateMachine::handleInactivityTimeout()
+{
+    // Any event restarts the timer, including the disconnect state change
+    if (module_state_ != ModuleState::disconnected)
+        return;
+
+    player_state_ = PlayerState::normal;
+    reportStats();
+    bt_module_.cancelAll();
+    pwr_ctrl_.sleep();
+    status_tracker_.reset();
+    bt_module_.forgetVolume();
+    const uint32_t wake_time_ms = getMillis();
+    wake_timeline_.start(wake_time_ms);
+    temp_schedule_.wake(wake_time_ms);
+    resetInactivityTimer();
+    event_queue_.postEvent(EventType::clock_tick);
+    // RN52 boots in the background
+    rn52_booting_ = true;
+    timers_.startPeriodic(TimerId::rn52_boot, 20);
+}
+
+void PlayerStateMachine::handleRn52BootPoll()
+{
+    if (!pollRn52Boot())
+        return;
+    timers_.stop(TimerId::rn52_boot);
+    rn52_booting_ = false;
+    const uint32_t now = getMillis();
+    wake_timeline_.mark(WakeMark::rn52_booted, now);
+    // Don't wait for the phone to find us
+    if (bt_module_.reconnect())
+        wake_timeline_.mark(WakeMark::reconnect_sent, now);
+    if (gpio2_deferred_) {
+        gpio2_deferred_ = false;
+        event_queue_.postEvent(EventType::rn52_gpio2);
+    }
+}
+
+void PlayerStateMachine::reportStats()
+{
+    getErrHndlr().report("Main loop passes/min: %lu\r\n", loop_passes_per_min_);
+    reportStackHighWater();
+    event_queue_.reportStats();
+    bt_module_.reportStats();
+    profiler_.report();
+    for (uint8_t i = 0; i < n_event_types; i++) {
+        if (event_latency_[i].count())
+            event_latency_[i].report(event_type_names[i]);
+    }
+    if (feedback_latency_.count())
+        feedback_latency_.report("btn feedback");
+    skip_burst_.reportStats();
+    getErrHndlr().report("Track changes: %lu, metadata fetches: %lu (%lu failed)\r\n",
+            n_track_changes_, n_metadata_fetches_, n_metadata_failures_);
+    track_cache_.reportStats();
+    getErrHndlr().report("RN52 status: %lu unchanged\r\n", n_status_unchanged_);
+}
+
 void PlayerStateMachine::processEvent(EventQueue::Event event)
 {
+    event_latency_[enumBaseT(event.event_)].record(cyclesToUs(cycleCount() - event.post_cycles_));
     getErrHndlr().report("SM: new event (%s)\r\n", event_type_names[enumBaseT(event.event_)]);
-    if (event.event_ != EventType::clock_tick)
-        pwr_ctrl_.resetInactivityTimer();
+    if (event.event_ != EventType::clock_tick && event.event_ != EventType::inactivity_timeout)
+        resetInactivityTimer();
 
     switch (event.event_) {
     case EventType::rn52_gpio2:
@@ -79,8 +216,33 @@ void PlayerStateMachine::processEvent(EventQueue::Event event)
         handleModuleStateChg(event.new_state_);
         break;
     case EventType::track_chg:
-        if (module_state_ == ModuleState::connected_streaming)
-            handleTrackChange();
+        handleTrackSettled();
+        break;
+    case EventType::rn52_rx:
+        // Boot output is consumed by `pollRn52Boot`
+        if (!rn52_booting_)
+            bt_module_.poll(getMillis());
+        break;
+    case EventType::rn52_status:
+        handleStatus(bt_module_.lastStatus());
+        break;
+    case EventType::rn52_meta_field:
+        handleMetaFields();
+        break;
+    case EventType::rn52_metadata:
+        handleMetadata();
+        break;
+    case EventType::rn52_track_event:
+        handleTrackEvent();
+        break;
+    case EventType::rn52_vol_event:
+        handleVolEvent();
+        break;
+    case EventType::rn52_profile_chg:
+        handleProfileChg();
+        break;
+    case EventType::rn52_passkey:
+        handlePasskey(event_queue_.payloads().get<Passkey>(event.payload_));
         break;
     case EventType::proximity_trigger:
         clearProxInterrupt();
@@ -89,6 +251,9 @@ void PlayerStateMachine::processEvent(EventQueue::Event event)
     case EventType::clock_tick:
         handleClockTick();
         break;
+    case EventType::inactivity_timeout:
+        handleInactivityTimeout();
+        break;
     case EventType::btn_play:
     case EventType::btn_next:
     case EventType::btn_prev:
@@ -109,20 +274,143 @@ void PlayerStateMachine::handleClockTick()
     if (module_state_ != ModuleState::disconnected)
         return;
 
+    const uint32_t now = getMillis();
+    switch (temp_schedule_.tick(now, tempMeasureTimeMs())) {
+    case TempSchedule::Action::start:
+        triggerTempMeasurement(now);
+        timers_.startOneShot(TimerId::sensor_read, tempMeasureTimeMs());
+        break;
+    case TempSchedule::Action::wait:
+        timers_.startOneShot(TimerId::sensor_read, temp_schedule_.msToResult(now, tempMeasureTimeMs()));
+        break;
+    case TempSchedule::Action::read:
+        // Usual case, only completed registers are read
+        handleSensorRead();
+        break;
+    }
+}
+
+void PlayerStateMachine::triggerTempMeasurement(uint32_t now_ms)
+{
+    if (!startTempMeasurement())
+        getErrHndlr().halt(ErrCode::i2c, "Sensor failure");
+    temp_schedule_.started(now_ms);
+}
+
+void PlayerStateMachine::handleSensorRead()
+{
+    if (module_state_ != ModuleState::disconnected)
+        return;
+    StageProfiler::Scope scope(profiler_, Stage::sensor_read);
+
     TimeData time_data;
     EnvData env_data;
-    const uint32_t secsActive = (getMillis() - lastWakeTime) / 1000;
-    bool success = getTime(time_data) && getTemp(env_data, secsActive);
+    // The result is from when the measurement started, up to a tick ago
+    bool success = getTime(time_data) && readTemp(env_data, temp_schedule_.secsActive());
     if (!success)
         getErrHndlr().halt(ErrCode::i2c, "Sensor failure");
 
     // Don't draw clock if we are still animating disconnect
     if (!draw_clock_when_display_ready_)
         display_.drawClockAndWeather(time_data, env_data);
+
+    // Sensor sleeps again once done, ready to read at the next tick
+    triggerTempMeasurement(getMillis());
+}
+
+constexpr uint16_t PlayerStateMachine::btnTableIdx(
+        PlayerState state, ModuleState module_state, EventType event)
+{
+    return (enumBaseT(state) * n_module_states + enumBaseT(module_state)) * n_btn_events
+            + enumBaseT(event) - enumBaseT(EventType::btn_play);
+}
+
+constexpr PlayerStateMachine::BtnTable PlayerStateMachine::buildBtnTable()
+{
+    using PS = PlayerState;
+    using MS = ModuleState;
+    using A = BtnAction;
+
+    BtnTable table {}; // all BtnAction::unset
+
+    auto set = [&table](PS state, MS module_state, EventType event, A action, PS next) {
+        table[btnTableIdx(state, module_state, event)] = { action, next };
+    };
+    auto setAllEvents = [&set](PS state, MS module_state, A action, PS next) {
+        for (uint8_t i = 0; i < n_btn_events; i++)
+            set(state, module_state, static_cast<EventType>(enumBaseT(EventType::btn_play) + i), action, next);
+    };
+    auto setAllModuleStates = [&set](PS state, EventType event, A action, PS next) {
+        for (uint8_t i = 0; i < n_module_states; i++)
+            set(state, static_cast<MS>(i), event, action, next);
+    };
+
+    // --- Normal - following module mode ---
+
+    setAllEvents(PS::normal, MS::disconnected, A::none, PS::normal);
+    set(PS::normal, MS::disconnected, EventType::btn_play_long_press, A::enter_menu, PS::menu);
+    setAllEvents(PS::normal, MS::pairing, A::none, PS::normal);
+    for (MS connected : { MS::connected, MS::connected_streaming }) {
+        setAllEvents(PS::normal, connected, A::none, PS::normal);
+        set(PS::normal, connected, EventType::btn_vol_up, A::vol_up,     PS::normal);
+        set(PS::normal, connected, EventType::btn_vol_dn, A::vol_down,   PS::normal);
+        set(PS::normal, connected, EventType::btn_next,   A::track_next, PS::normal);
+        set(PS::normal, connected, EventType::btn_prev,   A::track_prev, PS::normal);
+        set(PS::normal, connected, EventType::btn_play,   A::play_pause, PS::normal);
+    }
+
+    // --- Menu - only entered when disconnected, but handle any module state ---
+
+    setAllModuleStates(PS::menu, EventType::btn_prev,   A::exit_menu,      PS::normal);
+    setAllModuleStates(PS::menu, EventType::btn_play,   A::pair,           PS::normal);
+    setAllModuleStates(PS::menu, EventType::btn_next,   A::set_clock,      PS::set_clock);
+    setAllModuleStates(PS::menu, EventType::btn_vol_up, A::clear_pairings, PS::normal);
+    setAllModuleStates(PS::menu, EventType::btn_vol_dn, A::reboot,         PS::menu);
+    setAllModuleStates(PS::menu, EventType::btn_play_release,    A::none,  PS::menu);
+    setAllModuleStates(PS::menu, EventType::btn_play_long_press, A::none,  PS::menu);
+
+    // --- Set clock ---
+
+    setAllModuleStates(PS::set_clock, EventType::btn_prev,   A::clock_field_prev, PS::set_clock);
+    setAllModuleStates(PS::set_clock, EventType::btn_play,   A::exit_menu,        PS::normal);
+    setAllModuleStates(PS::set_clock, EventType::btn_next,   A::clock_field_next, PS::set_clock);
+    setAllModuleStates(PS::set_clock, EventType::btn_vol_up, A::clock_field_inc,  PS::set_clock);
+    setAllModuleStates(PS::set_clock, EventType::btn_vol_dn, A::clock_field_dec,  PS::set_clock);
+    setAllModuleStates(PS::set_clock, EventType::btn_play_release,    A::none,    PS::set_clock);
+    setAllModuleStates(PS::set_clock, EventType::btn_play_long_press, A::none,    PS::set_clock);
+
+    // --- Pairing - cancel on any button, vol+ accepts a passkey ---
+
+    for (MS module_state : { MS::disconnected, MS::connected, MS::connected_streaming }) {
+        setAllEvents(PS::pairing_listening, module_state, A::none, PS::pairing_listening);
+        setAllEvents(PS::pairing_got_code,  module_state, A::none, PS::pairing_got_code);
+    }
+    setAllEvents(PS::pairing_listening, MS::pairing, A::cancel_pairing, PS::normal);
+    setAllEvents(PS::pairing_got_code,  MS::pairing, A::cancel_pairing, PS::normal);
+    set(PS::pairing_got_code, MS::pairing, EventType::btn_vol_up, A::accept_pairing, PS::normal);
+
+    return table;
 }
 
+constexpr bool PlayerStateMachine::btnTableIsComplete(const BtnTable& table)
+{
+    for (const BtnTransition& transition : table) {
+        if (transition.action == BtnAction::unset)
+            return false;
+    }
+    return true;
+}
+
+// Lives in flash
+const PlayerStateMachine::BtnTable PlayerStateMachine::btn_table_ = buildBtnTable();
+
 void PlayerStateMachine::handleBtnPress(EventQueue::Event event)
 {
+    static_assert(enumBaseT(EventType::btn_play_long_press) - enumBaseT(EventType::btn_play) + 1
+            == n_btn_events, "button events must be contiguous");
+    static_assert(btnTableIsComplete(buildBtnTable()),
+            "every (state, module state, button) combination needs a transition");
+
     constexpr bool enable_haptic = false;
 
     if constexpr (enable_haptic) {
@@ -131,126 +419,128 @@ void PlayerStateMachine::handleBtnPress(EventQueue::Event event)
             triggerHaptic(haptic_duration_ms);
     }
 
-    // Track long press for play button
-    if (event.event_ == EventType::btn_play)
-        last_play_press_ms = getMillis();
-    else if (event.event_ == EventType::btn_play_release)
-        last_play_press_ms = 0;
-
-    // Delegate to handler for the current state
-    (this->*btn_handlers_[enumBaseT(player_state_)])(event);
+    const BtnTransition& transition = btn_table_[btnTableIdx(player_state_, module_state_, event.event_)];
+    player_state_ = transition.next_state;
+    btn_post_cycles_ = event.post_cycles_;
+    doBtnAction(transition.action);
 }
 
-void PlayerStateMachine::handleBtnNormal(EventQueue::Event event)
+void PlayerStateMachine::doBtnAction(BtnAction action)
 {
-    switch (module_state_) {
-    case ModuleState::disconnected:
-        if (event.event_ == EventType::btn_play_long_press)
-            enterMenuMode();
+    switch (action) {
+    case BtnAction::unset:
+    case BtnAction::none:
         break;
-    case ModuleState::pairing:
+    case BtnAction::vol_up:
+        showFeedback(Display::Feedback::vol_up, volume_feedback_ms);
+        bt_module_.volUp();
+        showVolume();
         break;
-    case ModuleState::connected:
-    case ModuleState::connected_streaming:
-        switch(event.event_) {
-        case EventType::btn_vol_up:
-            bt_module_.volUp();
-            break;
-        case EventType::btn_vol_dn:
-            bt_module_.volDown();
-            break;
-        case EventType::btn_next:
-            bt_module_.trackNext();
-            break;
-        case EventType::btn_prev:
-            bt_module_.trackPrev();
-            break;
-        case EventType::btn_play:
-            bt_module_.playPause();
-            break;
-        case EventType::btn_play_long_press:
-        case EventType::btn_play_release:
-            break;
-        // Illegal states
-        case EventType::rn52_gpio2:
-        case EventType::rn52_state_chg:
-        case EventType::track_chg:
-        case EventType::proximity_trigger:
-        case EventType::clock_tick:
-        case EventType::do_nothing_event:
-            break;
-        }
+    case BtnAction::vol_down:
+        showFeedback(Display::Feedback::vol_down, volume_feedback_ms);
+        bt_module_.volDown();
+        showVolume();
         break;
-    }
-}
-
-void PlayerStateMachine::handleBtnMenu(EventQueue::Event event)
-{
-    switch(event.event_) {
-    case EventType::btn_prev:
-         exitMenuMode();
-         break;
-    case EventType::btn_play:
+    case BtnAction::track_next:
+        showFeedback(Display::Feedback::next, transport_feedback_ms);
+        queueSkip(1);
+        break;
+    case BtnAction::track_prev:
+        showFeedback(Display::Feedback::prev, transport_feedback_ms);
+        queueSkip(-1);
+        break;
+    case BtnAction::play_pause:
+        showFeedback(Display::Feedback::play_pause, transport_feedback_ms);
+        bt_module_.playPause();
+        break;
+    case BtnAction::enter_menu:
+        enterMenuMode();
+        break;
+    case BtnAction::exit_menu:
+        exitMenuMode();
+        break;
+    case BtnAction::pair:
         bt_module_.enterPairingMode();
         exitMenuMode();
         break;
-    case EventType::btn_next:
+    case BtnAction::set_clock:
         enterSetClockMode();
         break;
-    case EventType::btn_vol_up:
+    case BtnAction::clear_pairings:
         bt_module_.resetPairings();
         display_.drawText(Display::TextPos::fullscreen, "All prior", "pairings cleared");
-        delayMs(1800);
-        exitMenuMode();
+        // Exit once the message has been read
+        timers_.startOneShot(TimerId::menu_message, 1800);
         break;
-    case EventType::btn_vol_dn:
+    case BtnAction::reboot:
         NVIC_SystemReset();
         break;
-    case EventType::btn_play_release:
-    case EventType::btn_play_long_press:
-    case EventType::rn52_gpio2:
-    case EventType::rn52_state_chg:
-    case EventType::track_chg:
-    case EventType::proximity_trigger:
-    case EventType::clock_tick:
-    case EventType::do_nothing_event:
+    case BtnAction::clock_field_prev:
+    case BtnAction::clock_field_next:
+    case BtnAction::clock_field_inc:
+    case BtnAction::clock_field_dec:
+        adjustClock(action);
+        break;
+    case BtnAction::cancel_pairing:
+        // RN52 state event will trigger clock redraw
+        bt_module_.exitPairingMode();
+        break;
+    case BtnAction::accept_pairing:
+        bt_module_.acceptPairing();
         break;
     }
 }
 
-struct ClockFieldWrapper {
-    uint8_t* const p_val;
-    const uint8_t min_val;
-    const uint8_t max_val;
-    // Increment value pointed to by p_val and roll back to min_val after max_val
-    void inc() const
-    {
-        *p_val = *p_val == max_val
-                ? min_val
-                : *p_val + 1;
-    }
-    // Decrement value pointed to by p_val and roll back to max_val after min_val
-    void dec() const
-    {
-        *p_val = *p_val == min_val
-                ? max_val
-                : *p_val - 1;
-    }
-};
+void PlayerStateMachine::showFeedback(Display::Feedback feedback, uint32_t rollback_ms)
+{
+    display_.showFeedback(feedback);
+    feedback_latency_.record(cyclesToUs(cycleCount() - btn_post_cycles_));
+    timers_.startOneShot(TimerId::feedback, rollback_ms);
+}
 
+void PlayerStateMachine::clearFeedback()
+{
+    timers_.stop(TimerId::feedback);
+    display_.clearFeedback();
+}
 
-void PlayerStateMachine::handleBtnSetClock(EventQueue::Event event)
+void PlayerStateMachine::queueSkip(int8_t direction)
 {
-    static ClockField clock_field = ClockField::day_of_month;
-    TimeData time_data;
-    static const ClockFieldWrapper p_fields[] = {
+    // First press goes out straight away
+    sendSkips(skip_burst_.press(direction, timers_.isActive(TimerId::skip_burst)));
+    timers_.startOneShot(TimerId::skip_burst, skip_burst_window_ms);
+}
+
+void PlayerStateMachine::handleSkipBurst()
+{
+    // Opposing presses cancel out
+    sendSkips(skip_burst_.takeRound());
+    if (skip_burst_.hasPending())
+        timers_.startOneShot(TimerId::skip_burst, skip_burst_window_ms);
+}
+
+void PlayerStateMachine::sendSkips(int8_t n)
+{
+    for (; n > 0; n--)
+        bt_module_.trackNext();
+    for (; n < 0; n++)
+        bt_module_.trackPrev();
+}
+
+void PlayerStateMachine::adjustClock(BtnAction action)
+{
+    struct ClockFieldRange {
+        uint8_t offset;
+        uint8_t min_val;
+        uint8_t max_val;
+    };
+    static constexpr ClockFieldRange ranges[] = {
         // order MUST match ClockField order
-        // Unfort. can't popular c style array statically by index
-        { reinterpret_cast<uint8_t*>(&time_data) + offsetof(TimeData, day_of_month), 1, 31 },
-        { reinterpret_cast<uint8_t*>(&time_data) + offsetof(TimeData, month),        1, 12 },
-        { reinterpret_cast<uint8_t*>(&time_data) + offsetof(TimeData, year),         0, 99 },
-        { reinterpret_cast<uint8_t*>(&time_data) + offsetof(TimeData, hours),        0, 23 },
-        { reinterpret_cast<uint8_t*>(&time_data) + offsetof(TimeData, minutes),      0, 59 }
+        { offsetof(TimeData, day_of_month), 1, 31 },
+        { offsetof(TimeData, month),        1, 12 },
+        { offsetof(TimeData, year),         0, 99 },
+        { offsetof(TimeData, hours),        0, 23 },
+        { offsetof(TimeData, minutes),      0, 59 }
     };
     // Check that ClockField matches above array element indices
     static_assert(enumBaseT(ClockField::day_of_month) == 0);
@@ -259,74 +549,44 @@ void PlayerStateMachine::handleBtnSetClock(EventQueue::Event event)
     static_assert(enumBaseT(ClockField::hours) == 3);
     static_assert(enumBaseT(ClockField::minutes) == 4);
 
+    // TimeData is guaranteed 8-bytes, ordered
+    TimeData time_data;
     getTime(time_data);
 
-    // TimeData is guaranteed 8-bytes, ordered
+    const ClockFieldRange& range = ranges[enumBaseT(clock_field_)];
+    uint8_t& val = reinterpret_cast<uint8_t*>(&time_data)[range.offset];
 
-    switch(event.event_) {
-    case EventType::btn_prev:
-        --clock_field;
-         break;
-    case EventType::btn_play:
-        exitMenuMode();
-        return; // avoid clock redraw
-    case EventType::btn_next:
-        ++clock_field;
+    switch (action) {
+    case BtnAction::clock_field_prev:
+        --clock_field_;
         break;
-    case EventType::btn_vol_up:
-        p_fields[enumBaseT(clock_field)].inc();
+    case BtnAction::clock_field_next:
+        ++clock_field_;
         break;
-    case EventType::btn_vol_dn:
-        p_fields[enumBaseT(clock_field)].dec();
+    // Roll over at min/max
+    case BtnAction::clock_field_inc:
+        val = val == range.max_val ? range.min_val : val + 1;
         break;
-    case EventType::btn_play_release:
-    case EventType::btn_play_long_press:
-    case EventType::rn52_gpio2:
-    case EventType::rn52_state_chg:
-    case EventType::track_chg:
-    case EventType::proximity_trigger:
-    case EventType::clock_tick:
-    case EventType::do_nothing_event:
+    case BtnAction::clock_field_dec:
+        val = val == range.min_val ? range.max_val : val - 1;
+        break;
+    default:
         return;
     }
     setTime(time_data);
     getTime(time_data); // get correct day_of_week field
-    display_.drawAdjustClock(time_data, clock_field);
-}
-
-void PlayerStateMachine::handleBtnPairListen(EventQueue::Event event)
-{
-    // Cancel on any button press
-    if (module_state_ == ModuleState::pairing) {
-        bt_module_.exitPairingMode();
-        player_state_ = PlayerState::normal;
-        // RN52 state event will trigger clock redraw
-        //handleClockTick();
-    }
-}
-
-void PlayerStateMachine::handleBtnPairGotCode(EventQueue::Event event)
-{
-    if (module_state_ != ModuleState::pairing)
-        return;
-
-    if (event.event_ == EventType::btn_vol_up)
-        bt_module_.acceptPairing();
-    else
-        // cancel on other button press
-        bt_module_.exitPairingMode();
-    player_state_ = PlayerState::normal;
+    display_.drawAdjustClock(time_data, clock_field_);
 }
 
 void PlayerStateMachine::enterMenuMode()
 {
+    timers_.stop(TimerId::menu_message);
+    reportStats();
     display_.drawMenu();
-    player_state_ = PlayerState::menu;
 }
 
 void PlayerStateMachine::exitMenuMode()
 {
-    player_state_ = PlayerState::normal;
     display_.exitMenu();
     // Menu is only supported when disconnected
     handleClockTick();
@@ -335,21 +595,63 @@ void PlayerStateMachine::exitMenuMode()
 
 void PlayerStateMachine::enterSetClockMode()
 {
-    player_state_ = PlayerState::set_clock;
+    clock_field_ = ClockField::day_of_month;
     TimeData time_data;
     getTime(time_data);
-    display_.drawAdjustClock(time_data, ClockField::day_of_month);
+    display_.drawAdjustClock(time_data, clock_field_);
 }
 
-void PlayerStateMachine::handleTrackChange()
+void PlayerStateMachine::handleTrackSettled()
 {
-    Rn52::MetaData meta = {}; // getMeta wont terminate fields it doesn't get
-    bool success = bt_module_.getMetadata(&meta);
+    if (module_state_ != ModuleState::connected_streaming)
+        return;
+    n_metadata_fetches_++;
+    // Parsed straight into the display's buffers
+    bt_module_.requestMetadata(display_.trackInfo());
+}
 
-    if (!success)
-        getErrHndlr().halt(ErrorCode::metadata_failure, "Metadata error\r\n");
+void PlayerStateMachine::handleMetaFields()
+{
+    const uint8_t fields = bt_module_.takeMetaFields();
+    if (fields & trackFieldBit(TrackField::duration))
+        progress_.setDuration(display_.trackInfo().duration_ms);
+    if (fields == 0 || module_state_ != ModuleState::connected_streaming)
+        return;
+    // Track change confirms a transport command
+    clearFeedback();
+    for (uint8_t i = 0; i < n_track_fields; i++) {
+        if (fields & (1u << i))
+            display_.drawMetaField(static_cast<TrackField>(i));
+    }
+    if (fields & trackFieldBit(TrackField::duration))
+        updateProgress();
+}
+
+void PlayerStateMachine::handleMetadata()
+{
+    // Fields completed with the last bytes may still be pending
+    handleMetaFields();
+    if (!bt_module_.lastMetadataOk()) {
+        // Rows already drawn stay, the next track change retries
+        n_metadata_failures_++;
+        getErrHndlr().report("Metadata error\r\n");
+        return;
+    }
+    track_cache_.store();
+    if (module_state_ != ModuleState::connected_streaming)
+        return;
+    // Blank rows for fields this track doesn't have
+    const uint8_t missing = ~bt_module_.metaFieldsReceived();
+    for (TrackField field : { TrackField::artist, TrackField::title }) {
+        if (missing & trackFieldBit(field))
+            display_.drawMetaField(field);
+    }
+}
 
-    display_.drawMetaText(meta.artist, meta.title);
+void PlayerStateMachine::redrawMetadata()
+{
+    display_.drawMetaField(TrackField::artist);
+    display_.drawMetaField(TrackField::title);
 }
 
 static ModuleState rn52StateToOurs(uint16_t status)
@@ -427,10 +729,18 @@ static void printStatus(uint16_t status)
     getErrHndlr().report(")\r\n");
 }
 
-/// Process RN52 GPIO2 event and dispatch appropriate sub events
+/// Query the RN52 status, `handleStatus` dispatches sub events
 void PlayerStateMachine::handleGpio2Event()
 {
-    uint16_t status = bt_module_.queryStatus();
+    if (rn52_booting_) {
+        gpio2_deferred_ = true;
+        return;
+    }
+    bt_module_.requestStatus();
+}
+
+void PlayerStateMachine::handleStatus(uint16_t status)
+{
     if (status == Rn52::query_status_error) {
         display_.drawText(Display::TextPos::fullscreen, "RN52", "Status error");
         disableExtIrqs();
@@ -441,15 +751,75 @@ void PlayerStateMachine::handleGpio2Event()
         disableExtIrqs();
         getErrHndlr().halt(ErrCode::illegal_state, "RN52 is in limbo");
     }
-    else {
-        getErrHndlr().report("Status: %02x\r\n", status);
-        printStatus(status);
-        ModuleState state = rn52StateToOurs(status);
-        event_queue_.postEvent(EventType::rn52_state_chg, state);
-        if (status & Rn52::StatusFlags::track_change_event) {
-            event_queue_.postEvent(EventType::track_chg, state);
-        }
+    const uint16_t prev_status = status_tracker_.last();
+    const Rn52StatusTracker::Delta delta = status_tracker_.update(status);
+    if (delta.empty()) {
+        n_status_unchanged_++;
+        return;
     }
+
+    getErrHndlr().report("Status: %04x\r\n", status);
+    printStatus(status);
+    if (delta.changed & Rn52StatusTracker::state_mask) {
+        // Several RN52 states map to each of ours
+        const ModuleState state = rn52StateToOurs(status);
+        if (state != rn52StateToOurs(prev_status))
+            event_queue_.postEvent(EventType::rn52_state_chg, state);
+    }
+    if (delta.changed & Rn52StatusTracker::profile_mask)
+        event_queue_.postEvent(EventType::rn52_profile_chg);
+    if (delta.events & statusBit(Rn52::StatusFlags::track_change_event))
+        event_queue_.postEvent(EventType::rn52_track_event);
+    if (delta.events & statusBit(Rn52::StatusFlags::audio_vol_change_event))
+        event_queue_.postEvent(EventType::rn52_vol_event);
+}
+
+void PlayerStateMachine::handleTrackEvent()
+{
+    n_track_changes_++;
+    track_cache_.invalidate();
+    progress_.restart(getMillis());
+    timers_.stop(TimerId::progress);
+    display_.hideProgress();
+    // Only the track we settle on is fetched
+    if (module_state_ == ModuleState::connected_streaming)
+        timers_.startOneShot(TimerId::track_settle, track_settle_ms);
+}
+
+void PlayerStateMachine::handleVolEvent()
+{
+    bt_module_.notifyVolumeChanged();
+    if (module_state_ != ModuleState::connected && module_state_ != ModuleState::connected_streaming)
+        return;
+    // Confirms a volume button, or the phone changed it
+    clearFeedback();
+    showVolume();
+}
+
+void PlayerStateMachine::showVolume()
+{
+    const VolumeModel& volume = bt_module_.volume();
+    display_.showVolume(volume.low(), volume.high(), VolumeModel::max_level);
+    timers_.startOneShot(TimerId::volume_bar, volume_bar_ms);
+}
+
+void PlayerStateMachine::updateProgress()
+{
+    if (module_state_ != ModuleState::connected_streaming || !progress_.hasDuration())
+        return;
+    const uint32_t now = getMillis();
+    display_.showProgress(progress_.filledWidth(now, Display::progress_w));
+    const uint32_t ms = progress_.msToNextPixel(now, Display::progress_w);
+    if (ms == PlaybackProgress::never)
+        timers_.stop(TimerId::progress);
+    else
+        timers_.startOneShot(TimerId::progress, ms);
+}
+
+void PlayerStateMachine::handleProfileChg()
+{
+    const uint16_t profiles = status_tracker_.last() & Rn52StatusTracker::profile_mask;
+    getErrHndlr().report("RN52 profiles: %04x\r\n", profiles);
 }
 
 void PlayerStateMachine::handleModuleStateChg(ModuleState new_state)
@@ -460,6 +830,10 @@ void PlayerStateMachine::handleModuleStateChg(ModuleState new_state)
 
     switch(new_state) {
     case ModuleState::disconnected:
+        // Next connection may be a different phone
+        track_cache_.invalidate();
+        bt_module_.forgetVolume();
+        progress_ = PlaybackProgress();
         pwr_ctrl_.setState(PwrControl::PwrState::clock);
         // Need to wait for display disconnect anim to finish
         draw_clock_when_display_ready_ = true;
@@ -467,6 +841,9 @@ void PlayerStateMachine::handleModuleStateChg(ModuleState new_state)
     case ModuleState::connected:
     case ModuleState::connected_streaming:
         pwr_ctrl_.setState(PwrControl::PwrState::connected);
+        wake_timeline_.mark(WakeMark::connected, getMillis());
+        if (new_state == ModuleState::connected_streaming)
+            wake_timeline_.mark(WakeMark::streaming, getMillis());
         break;
     case ModuleState::pairing:
         break;
@@ -478,13 +855,27 @@ void PlayerStateMachine::handleModuleStateChg(ModuleState new_state)
         player_state_ = PlayerState::normal;
     }
 
+    // Redraw replaces any feedback glyph, the volume and progress bars
+    timers_.stop(TimerId::feedback);
+    timers_.stop(TimerId::volume_bar);
+    timers_.stop(TimerId::progress);
+    if (new_state == ModuleState::connected_streaming)
+        progress_.resume(getMillis());
+    else
+        progress_.pause(getMillis());
     display_.notifyNewModuleState(new_state, old_state);
     module_state_ = new_state;
 
     if (new_state == ModuleState::pairing)
         handleEnterPairingMode();
-    else if (new_state == ModuleState::connected_streaming)
-        handleTrackChange();
+    else if (new_state == ModuleState::connected_streaming) {
+        // Resuming the same track needs no query
+        if (track_cache_.lookup())
+            redrawMetadata();
+        else
+            handleTrackSettled();
+        updateProgress();
+    }
 }
 
 
@@ -494,16 +885,14 @@ void PlayerStateMachine::handleEnterPairingMode()
     player_state_ = PlayerState::pairing_listening;
 }
 
-void PlayerStateMachine::handlePairingModeListening()
+void PlayerStateMachine::handlePasskey(const Passkey& passkey)
 {
-    char passkey[6];
-    bool got_key = bt_module_.awaitPairingPasskey(passkey); // 50ms timeout
-    if (got_key) {
-        constexpr size_t len = sizeof("Code: 123456\0");
-        char code[len];
-        snprintf(code, len, "Code: %.*s", 6, passkey);
-        display_.drawText(Display::TextPos::pairing, code, "[vol+] accept");
-        getErrHndlr().report("Got passkey '%.*s'\r\n", (int)6, passkey);
-        player_state_ = PlayerState::pairing_got_code;
-    }
+    if (player_state_ != PlayerState::pairing_listening)
+        return;
+    constexpr size_t len = sizeof("Code: 123456\0");
+    char code[len];
+    snprintf(code, len, "Code: %.*s", 6, passkey.digits);
+    display_.drawText(Display::TextPos::pairing, code, "[vol+] accept");
+    getErrHndlr().report("Got passkey '%.*s'\r\n", (int)6, passkey.digits);
+    player_state_ = PlayerState::pairing_got_code;
 }
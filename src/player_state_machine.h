@@ -1,10 +1,20 @@
 #ifndef SRC_PLAYER_STATE_HPP_
 #define SRC_PLAYER_STATE_HPP_
 
+#include <array>
 #include <bt_module.h>
 #include <display.h>
 #include <event_queue.h>
 #include <pwr_control.h>
+#include <latency_histogram.h>
+#include <stage_profiler.h>
+#include <timer_service.h>
+#include <track_cache.h>
+#include <rn52_status.h>
+#include <playback_progress.h>
+#include <wake_timeline.h>
+#include <skip_burst.h>
+#include <temp_schedule.h>
 #include <app.h>
 
 /**
@@ -25,32 +35,59 @@ public:
 
 private:
     enum class PlayerState : uint8_t {
-        // DO NOT REORDER or assign values
         normal,            ///< Following module mode
         menu,              ///< menu
         set_clock,         ///< set clock
         pairing_listening, ///< pairing, waiting for connection
         pairing_got_code,  ///< pairing, waiting for user confirmation
     };
-    using HandleBtnPressFunc = void (PlayerStateMachine::*)(EventQueue::Event);
-    HandleBtnPressFunc btn_handlers_[5] = {
-            &PlayerStateMachine::handleBtnNormal,
-            &PlayerStateMachine::handleBtnMenu,
-            &PlayerStateMachine::handleBtnSetClock,
-            &PlayerStateMachine::handleBtnPairListen,
-            &PlayerStateMachine::handleBtnPairGotCode
-    } ;
-    void handleBtnNormal(EventQueue::Event event);
-    void handleBtnMenu(EventQueue::Event event);
-    void handleBtnSetClock(EventQueue::Event event);
-    void handleBtnPairListen(EventQueue::Event event);
-    void handleBtnPairGotCode(EventQueue::Event event);
-    // make it harder to accidently make a breaking change above
-    static_assert(Libp::enumBaseT(PlayerState::normal) == 0);
-    static_assert(Libp::enumBaseT(PlayerState::menu) == 1);
-    static_assert(Libp::enumBaseT(PlayerState::set_clock) == 2);
-    static_assert(Libp::enumBaseT(PlayerState::pairing_listening) == 3);
-    static_assert(Libp::enumBaseT(PlayerState::pairing_got_code) == 4);
+    static constexpr uint8_t n_player_states = 5;
+    static_assert(n_player_states == static_cast<uint8_t>(PlayerState::pairing_got_code) + 1);
+    /// Button events are contiguous: btn_play -> btn_play_long_press
+    static constexpr uint8_t n_btn_events = 7;
+
+    /// Response to a button event
+    enum class BtnAction : uint8_t {
+        unset, ///< only used to check the table is complete
+        none,
+        vol_up, vol_down, track_next, track_prev, play_pause,
+        enter_menu, exit_menu, pair, set_clock, clear_pairings, reboot,
+        clock_field_prev, clock_field_next, clock_field_inc, clock_field_dec,
+        cancel_pairing, accept_pairing,
+    };
+    struct BtnTransition {
+        BtnAction action;
+        PlayerState next_state;
+    };
+    /// (player state, module state, button event) -> transition
+    using BtnTable = std::array<BtnTransition, n_player_states * n_module_states * n_btn_events>;
+
+    static constexpr uint16_t btnTableIdx(PlayerState state, ModuleState module_state, EventType event);
+    static constexpr BtnTable buildBtnTable();
+    static constexpr bool btnTableIsComplete(const BtnTable& table);
+    static const BtnTable btn_table_;
+
+    void doBtnAction(BtnAction action);
+
+    /// Rollback time for unconfirmed button feedback
+    static constexpr uint32_t transport_feedback_ms = 1500;
+    static constexpr uint32_t volume_feedback_ms = 600;
+    /// Volume bar stays up after the last change
+    static constexpr uint32_t volume_bar_ms = 2000;
+    /// Draw button feedback before the command is sent to the RN52
+    void showFeedback(Display::Feedback feedback, uint32_t rollback_ms);
+    void clearFeedback();
+
+    /// Further skips within this window of the last are sent as one burst
+    static constexpr uint32_t skip_burst_window_ms = 300;
+    /// Metadata is fetched once track changes stop for this long
+    static constexpr uint32_t track_settle_ms = 400;
+    /// Send a skip now if idle, otherwise add it to the burst
+    void queueSkip(int8_t direction);
+    /// Send the net skips queued during the burst window, a round at a time
+    void handleSkipBurst();
+    /// Send `n` next (> 0) or previous (< 0) skips
+    void sendSkips(int8_t n);
 
     /// Our state
     PlayerState player_state_ = PlayerState::normal;
@@ -62,32 +99,119 @@ private:
     BtModule& bt_module_;
     Display& display_;
     PwrControl& pwr_ctrl_;
+    TimerService timers_;
+
+    WakeTimeline wake_timeline_;
+
+    /// Measurement started for the next clock tick
+    TempSchedule temp_schedule_;
+
+    /// RN52 is booting after wake, commands can't be sent yet
+    bool rn52_booting_ = false;
+    /// GPIO2 event arrived while booting, handle once booted
+    bool gpio2_deferred_ = false;
 
-    /// Monitor long press of play button
-    uint32_t last_play_press_ms = 0;
+    /// Post to dispatch latency for each `EventType`
+    LatencyHistogram event_latency_[n_event_types];
+    /// Button press to feedback glyph flushed
+    LatencyHistogram feedback_latency_;
+    /// Post time of the button event being handled
+    uint32_t btn_post_cycles_ = 0;
+
+    SkipBurst skip_burst_;
+    /// Track changes reported and the metadata fetches done for them
+    uint32_t n_track_changes_ = 0;
+    uint32_t n_metadata_fetches_ = 0;
+    uint32_t n_metadata_failures_ = 0;
+    /// Is the display's track info still current
+    TrackCache track_cache_;
+
+    /// Interpolated position of the current track
+    PlaybackProgress progress_;
+
+    /// Last RN52 status, only changes are dispatched
+    Rn52StatusTracker status_tracker_;
+    uint32_t n_status_unchanged_ = 0;
+
+    /// Main loop stage timing, see PROFILE_STAGES
+    StageProfiler profiler_;
+
+    /// Main loop passes, counted over 1 minute windows. Not core wakeups,
+    /// which include every SysTick.
+    uint32_t n_loop_passes_ = 0;
+    uint32_t loop_passes_per_min_ = 0;
+
+    /// Field being edited in set_clock state
+    ClockField clock_field_ = ClockField::day_of_month;
 
     /// Triggers shutdown once animations are finished
     bool draw_clock_when_display_ready_ = false;
 
-    /// Shutdown and sleep if inactive
-    void sleepIfInactive();
+    /// Shutdown and sleep if still disconnected
+    void handleInactivityTimeout();
+    void resetInactivityTimer();
+
+    /// Draw due animation frames
+    void handleAnimationTimer();
+    /// Arm the animation timer for the next frame due
+    void scheduleAnimationTimer();
+    /// Arm the RN52 command timeout
+    void scheduleRn52Timer();
+
+    /**
+     * Sleep (WFI) until an event is posted or `timeout_ms` has elapsed.
+     *
+     * SysTick keeps running for `getMillis`, so the core still wakes every
+     * ms; only the main loop pass is skipped.
+     */
+    void waitForEvent(uint32_t timeout_ms);
+
+    /// Dump runtime statistics to the debug UART
+    void reportStats();
 
     /// Top level event processor
     void processEvent(EventQueue::Event event);
-    /// Delegates button press to appropriate handler
+    /// Looks up and performs the transition for a button event
     void handleBtnPress(EventQueue::Event event);
 
+    /**
+     * Draws the clock with the measurement started after the last tick,
+     * starting one first if there is none
+     */
     void handleClockTick();
+    /// Draw the clock and start the next measurement
+    void handleSensorRead();
+    void triggerTempMeasurement(uint32_t now_ms);
+    /// Wait for the RN52 to boot after wake
+    void handleRn52BootPoll();
     void handleProximityEvent();
     void handleGpio2Event();
+    /// Dispatch events for what changed since the last status
+    void handleStatus(uint16_t status);
+    void handleTrackEvent();
+    void handleVolEvent();
+    /// Show the volume bar and restart its timeout
+    void showVolume();
+    /// Draw the progress bar and schedule its next pixel
+    void updateProgress();
+    void handleProfileChg();
     void handleModuleStateChg(ModuleState new_state);
-    void handleTrackChange();
+    /// Request metadata for the settled track
+    void handleTrackSettled();
+    /// Draw metadata fields as they arrive
+    void handleMetaFields();
+    /// Metadata request completed
+    void handleMetadata();
+    /// Redraw track info already held by the display
+    void redrawMetadata();
 
     void enterMenuMode();
     void exitMenuMode();
     void enterSetClockMode();
+    void adjustClock(BtnAction action);
     void handleEnterPairingMode();
-    void handlePairingModeListening();
+    /// Show the code to confirm if we are waiting for one
+    void handlePasskey(const Passkey& passkey);
 };
 
 #endif /* SRC_PLAYER_STATE_HPP_ */
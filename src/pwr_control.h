@@ -76,25 +76,14 @@ public:
         prepareToWake();
         setState(PwrState::clock);
         getErrHndlr().report("awake\r\n");
-        // Must be called post powering the RN52 (discards incoming 'CMD')
-        initRn52();
+        // Must be called post powering the RN52. Caller must poll
+        // `pollRn52Boot` before using the module.
+        startRn52();
         oledUpdateBrightness( getLightLvl() );
     }
 
-    bool timeToSleep()
-    {
-        return (Libp::getMillis() - last_activity_time_ms) > inactivity_sleep_time_ms;
-    }
-
-    void resetInactivityTimer()
-    {
-        last_activity_time_ms = Libp::getMillis();
-    }
-
-private:
-    // Sleep after 3 minutes of inactivity
+    /// Sleep after 3 minutes of inactivity
     static constexpr uint32_t inactivity_sleep_time_ms = 3 * 60 * 1000;
-    uint32_t last_activity_time_ms = 0;
 };
 
 #endif /* SRC_PWR_CONTROL_H_ */
@@ -0,0 +1,279 @@
+#include <cstdlib>
+#include <cstring>
+#include <cctype>
+#include "libpekin.h"
+#include <drivers/wireless/rn_52.h>
+#include <rn52_cmd_engine.h>
+
+static bool startsWith(const char* str, const char* prefix)
+{
+    return strncmp(str, prefix, strlen(prefix)) == 0;
+}
+
+static bool endsWith(const char* str, const char* suffix)
+{
+    const size_t len = strlen(str);
+    const size_t suffix_len = strlen(suffix);
+    return len >= suffix_len && strcmp(str + len - suffix_len, suffix) == 0;
+}
+
+static bool isError(const char* line)
+{
+    return startsWith(line, "ERR") || line[0] == '?';
+}
+
+bool Rn52CmdEngine::submit(const Rn52Cmd& cmd, TrackInfo* track_info)
+{
+    if (n_queued_ == queue_len) {
+        n_queue_full_++;
+        return false;
+    }
+    queue_[(read_idx_ + n_queued_) % queue_len] = { &cmd, track_info, cycleCount() };
+    n_queued_++;
+    if (n_queued_ > queue_high_water_)
+        queue_high_water_ = n_queued_;
+    if (in_flight_ == nullptr)
+        sendNext(Libp::getMillis());
+    return true;
+}
+
+void Rn52CmdEngine::sendNext(uint32_t now_ms)
+{
+    if (n_queued_ == 0)
+        return;
+    const Queued& next = queue_[read_idx_];
+    read_idx_ = (read_idx_ + 1) % queue_len;
+    n_queued_--;
+
+    in_flight_ = next.cmd;
+    in_flight_submit_cycles_ = next.submit_cycles;
+    retries_left_ = in_flight_->retries;
+    meta_dest_ = next.track_info;
+    send(now_ms);
+}
+
+void Rn52CmdEngine::send(uint32_t now_ms)
+{
+    n_sent_++;
+    sent_ms_ = now_ms;
+    if (in_flight_->response == Rn52Response::metadata) {
+        meta_parser_.begin(*meta_dest_);
+        meta_fields_received_ = 0;
+    }
+    link_.write(in_flight_->text);
+    link_.write("\r");
+}
+
+void Rn52CmdEngine::poll(uint32_t now_ms)
+{
+    while (true) {
+        if (in_flight_ && in_flight_->response == Rn52Response::metadata) {
+            if (!pollMetadata(now_ms))
+                break;
+            continue;
+        }
+        const char* line;
+        if (!link_.readLine(line))
+            break;
+        if (in_flight_ == nullptr || !match(line, now_ms))
+            handleUnsolicited(line);
+    }
+
+    if (in_flight_ && now_ms - sent_ms_ >= in_flight_->timeout_ms) {
+        n_timeouts_++;
+        // Metadata has no terminator if the phone doesn't send Time(ms)
+        if (in_flight_->response == Rn52Response::metadata && meta_fields_received_)
+            complete(true);
+        else
+            fail(now_ms);
+    }
+
+    if (in_flight_ == nullptr)
+        sendNext(now_ms);
+}
+
+uint32_t Rn52CmdEngine::msToDeadline(uint32_t now_ms) const
+{
+    if (in_flight_ == nullptr)
+        return never;
+    const uint32_t elapsed = now_ms - sent_ms_;
+    return elapsed >= in_flight_->timeout_ms ? 0 : in_flight_->timeout_ms - elapsed;
+}
+
+bool Rn52CmdEngine::match(const char* line, uint32_t now_ms)
+{
+    switch (in_flight_->response) {
+    case Rn52Response::aok:
+        if (startsWith(line, "AOK"))
+            complete(true);
+        else if (isError(line))
+            fail(now_ms);
+        else
+            return false;
+        return true;
+
+    case Rn52Response::status: {
+        if (isError(line)) {
+            fail(now_ms);
+            return true;
+        }
+        char* end;
+        const unsigned long status = strtoul(line, &end, 16);
+        if (end - line != 4 || *end != '\0')
+            return false;
+        complete(true, static_cast<uint16_t>(status));
+        return true;
+    }
+
+    case Rn52Response::metadata:
+        // Streamed by `pollMetadata`
+        return false;
+
+    case Rn52Response::reboot:
+        // "Reboot" at the old rate can run into "CMD" after a rate switch
+        if (endsWith(line, "CMD"))
+            complete(true);
+        // Swallow "Reboot" and anything else during boot
+        return true;
+
+    case Rn52Response::value:
+        if (isError(line)) {
+            fail(now_ms);
+            return true;
+        }
+        strncpy(value_, line, sizeof(value_) - 1);
+        value_[sizeof(value_) - 1] = '\0';
+        complete(true);
+        return true;
+    }
+    return false;
+}
+
+bool Rn52CmdEngine::pollMetadata(uint32_t now_ms)
+{
+    const char* data;
+    const uint16_t n = link_.peek(data);
+    if (n == 0)
+        return false;
+
+    uint16_t used = 0;
+    while (used < n) {
+        const MetadataParser::Result result = meta_parser_.feed(data[used++]);
+        if (result == MetadataParser::Result::none)
+            continue;
+        if (result == MetadataParser::Result::error) {
+            link_.consume(used);
+            fail(now_ms);
+            return true;
+        }
+        // Each field restarts the timeout
+        sent_ms_ = now_ms;
+        const uint8_t bit = trackFieldBit(meta_parser_.lastField());
+        meta_fields_received_ |= bit;
+        meta_fields_new_ |= bit;
+        event_queue_.postEvent(EventType::rn52_meta_field);
+        if (result == MetadataParser::Result::end) {
+            // Anything after is line based again
+            link_.consume(used);
+            complete(true);
+            return true;
+        }
+    }
+    link_.consume(used);
+    return true;
+}
+
+void Rn52CmdEngine::fail(uint32_t now_ms)
+{
+    if (retries_left_ > 0) {
+        retries_left_--;
+        n_retries_++;
+        send(now_ms);
+        return;
+    }
+    complete(false);
+}
+
+void Rn52CmdEngine::complete(bool success, uint16_t status)
+{
+    const Rn52Cmd* cmd = in_flight_;
+    in_flight_ = nullptr;
+    cmd_latency_.record(cyclesToUs(cycleCount() - in_flight_submit_cycles_));
+    if (!success) {
+        n_failed_++;
+        getErrHndlr().report("RN52 '%s' failed\r\n", cmd->text);
+    }
+
+    switch (cmd->response) {
+    case Rn52Response::status:
+        last_status_ = success ? status : Libp::Rn52::query_status_error;
+        event_queue_.postEvent(EventType::rn52_status);
+        break;
+    case Rn52Response::metadata:
+        meta_dest_ = nullptr;
+        last_metadata_ok_ = success;
+        event_queue_.postEvent(EventType::rn52_metadata);
+        break;
+    case Rn52Response::value:
+        if (!success)
+            value_[0] = '\0';
+        break;
+    case Rn52Response::aok:
+    case Rn52Response::reboot:
+        break;
+    }
+}
+
+bool Rn52CmdEngine::runUntilIdle()
+{
+    const uint32_t n_failed = n_failed_;
+    while (!isIdle())
+        poll(Libp::getMillis());
+    return n_failed_ == n_failed;
+}
+
+void Rn52CmdEngine::cancelAll()
+{
+    in_flight_ = nullptr;
+    n_queued_ = 0;
+    meta_dest_ = nullptr;
+    link_.discard();
+}
+
+void Rn52CmdEngine::handleUnsolicited(const char* line)
+{
+    n_unsolicited_++;
+    // Passkey is the only run of 6 digits the module sends
+    constexpr uint8_t passkey_len = sizeof(Passkey::digits);
+    uint8_t n_digits = 0;
+    for (const char* c = line; *c; c++) {
+        n_digits = isdigit(static_cast<unsigned char>(*c)) ? n_digits + 1 : 0;
+        if (n_digits == passkey_len && !isdigit(static_cast<unsigned char>(c[1]))) {
+            postPasskey(c - (passkey_len - 1));
+            return;
+        }
+    }
+    getErrHndlr().report("RN52: %s\r\n", line);
+}
+
+void Rn52CmdEngine::postPasskey(const char* digits)
+{
+    PayloadPool& payloads = event_queue_.payloads();
+    const PayloadPool::Handle handle = payloads.alloc();
+    if (handle == PayloadPool::no_payload) {
+        // Phone shows the code again if pairing is retried
+        n_passkeys_lost_++;
+        return;
+    }
+    memcpy(payloads.get<Passkey>(handle).digits, digits, sizeof(Passkey::digits));
+    event_queue_.postEvent(EventType::rn52_passkey, ModuleState::disconnected, handle);
+}
+
+void Rn52CmdEngine::reportStats()
+{
+    getErrHndlr().report("RN52 cmds: %lu sent, %lu retries, %lu timeouts, %lu failed\r\n",
+            n_sent_, n_retries_, n_timeouts_, n_failed_);
+    getErrHndlr().report("RN52 queue: %u/%u high water, %lu full, %lu unsolicited, %lu passkeys lost\r\n",
+            queue_high_water_, queue_len, n_queue_full_, n_unsolicited_, n_passkeys_lost_);
+    cmd_latency_.report("RN52 cmd");
+}
@@ -0,0 +1,181 @@
+#ifndef SRC_RN52_CMD_ENGINE_H_
+#define SRC_RN52_CMD_ENGINE_H_
+
+#include <cstdint>
+#include <devices/rn52_link.h>
+#include <event_queue.h>
+#include <latency_histogram.h>
+#include <metadata_parser.h>
+#include <track_info.h>
+
+/// How a command's response is matched
+enum class Rn52Response : uint8_t {
+    aok,      ///< "AOK"
+    status,   ///< 4 hex digits, posts `rn52_status`
+    metadata, ///< streamed into a `TrackInfo`, posts `rn52_meta_field`
+              ///< per field and `rn52_metadata` when done
+    reboot,   ///< "CMD" once rebooted
+    value,    ///< any line, e.g. a setting read back by a get command
+};
+
+/// Static description of an RN52 command, lives in flash
+struct Rn52Cmd {
+    const char* text;    ///< without the trailing CR
+    Rn52Response response;
+    uint16_t timeout_ms; ///< per attempt, restarted by each metadata line
+    uint8_t retries;     ///< only for commands that are safe to repeat
+};
+
+/**
+ * Non-blocking RN52 command engine.
+ *
+ * Commands are queued and sent back to back: the RN52 handles one command
+ * at a time, so the next is sent as soon as the previous response has
+ * been matched. Commands with results post an event on completion; for the
+ * rest failures are only counted.
+ *
+ * `poll` must be called when `rn52_rx` is posted and when
+ * `msToDeadline` expires. Lines that don't match the command in flight are
+ * treated as unsolicited; a pairing passkey among them is posted with
+ * `rn52_passkey`.
+ */
+class Rn52CmdEngine {
+public:
+    static constexpr uint32_t never = UINT32_MAX;
+
+    Rn52CmdEngine(Rn52Link& link, EventQueue& event_queue)
+            : link_(link), event_queue_(event_queue) { }
+
+    /**
+     * Queue a command, sending it now if none are in flight
+     *
+     * @param track_info destination for `Rn52Response::metadata`, must
+     *                   outlive the command
+     * @return false if the queue is full
+     */
+    bool submit(const Rn52Cmd& cmd, TrackInfo* track_info = nullptr);
+
+    /// Match received lines, handle timeouts and send the next command
+    void poll(uint32_t now_ms);
+
+    /// @return ms until `poll` must be called for a timeout, or `never`
+    uint32_t msToDeadline(uint32_t now_ms) const;
+
+    bool isIdle() const
+    {
+        return in_flight_ == nullptr && n_queued_ == 0;
+    }
+
+    /**
+     * Blocking. Poll until all queued commands have completed.
+     *
+     * @return false if any of them failed
+     */
+    bool runUntilIdle();
+
+    /// Drop all queued and in flight commands, e.g. when the module is
+    /// powered down
+    void cancelAll();
+
+    /// Result of the last status query, `Libp::Rn52::query_status_error` if
+    /// it failed
+    uint16_t lastStatus() const
+    {
+        return last_status_;
+    }
+
+    /// Result of the last `Rn52Response::value` command, empty if it failed
+    const char* lastValue() const
+    {
+        return value_;
+    }
+
+    /// Result of the last metadata request
+    bool lastMetadataOk() const
+    {
+        return last_metadata_ok_;
+    }
+
+    /**
+     * Take the fields completed since the last call
+     *
+     * @return mask of `trackFieldBit`
+     */
+    uint8_t takeMetaFields()
+    {
+        const uint8_t fields = meta_fields_new_;
+        meta_fields_new_ = 0;
+        return fields;
+    }
+
+    /// Fields received by the last (or current) metadata request
+    uint8_t metaFieldsReceived() const
+    {
+        return meta_fields_received_;
+    }
+
+    /// Dump counters and command latency to the debug UART
+    void reportStats();
+
+private:
+    static constexpr uint8_t queue_len = 8;
+    /// Longest setting is the 20 character name
+    static constexpr uint8_t value_len = 24;
+
+    struct Queued {
+        const Rn52Cmd* cmd;
+        TrackInfo* track_info;
+        uint32_t submit_cycles;
+    };
+
+    Rn52Link& link_;
+    EventQueue& event_queue_;
+
+    Queued queue_[queue_len];
+    uint8_t read_idx_ = 0;
+    uint8_t n_queued_ = 0;
+
+    const Rn52Cmd* in_flight_ = nullptr;
+    uint32_t in_flight_submit_cycles_ = 0;
+    uint32_t sent_ms_ = 0;
+    uint8_t retries_left_ = 0;
+    /// Metadata destination while a metadata command is in flight
+    TrackInfo* meta_dest_ = nullptr;
+    MetadataParser meta_parser_;
+    uint8_t meta_fields_new_ = 0;
+    uint8_t meta_fields_received_ = 0;
+    bool last_metadata_ok_ = false;
+
+    uint16_t last_status_ = 0;
+    char value_[value_len] = {};
+
+    uint32_t n_sent_ = 0;
+    uint32_t n_retries_ = 0;
+    uint32_t n_timeouts_ = 0;
+    uint32_t n_failed_ = 0;
+    uint32_t n_queue_full_ = 0;
+    uint32_t n_unsolicited_ = 0;
+    uint32_t n_passkeys_lost_ = 0;
+    uint8_t queue_high_water_ = 0;
+    /// Submit to completion
+    LatencyHistogram cmd_latency_;
+
+    void sendNext(uint32_t now_ms);
+    void send(uint32_t now_ms);
+    /// @return true if `line` was consumed by the command in flight
+    bool match(const char* line, uint32_t now_ms);
+    /**
+     * Feed received bytes to the metadata parser
+     *
+     * @return false if there was no data
+     */
+    bool pollMetadata(uint32_t now_ms);
+    /// Retry if allowed, otherwise complete as failed
+    void fail(uint32_t now_ms);
+    void complete(bool success, uint16_t status = 0);
+    void handleUnsolicited(const char* line);
+    /// Post 6 passkey digits with `rn52_passkey`
+    void postPasskey(const char* digits);
+};
+
+#endif /* SRC_RN52_CMD_ENGINE_H_ */
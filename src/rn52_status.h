@@ -0,0 +1,70 @@
+#ifndef SRC_RN52_STATUS_H_
+#define SRC_RN52_STATUS_H_
+
+#include <cstdint>
+#include <drivers/wireless/rn_52.h>
+
+/// Status word bit for `flag`
+inline constexpr uint16_t statusBit(Libp::Rn52::StatusFlags flag)
+{
+    return static_cast<uint16_t>(flag);
+}
+
+/**
+ * Diffs successive RN52 status words so only what changed is dispatched.
+ *
+ * The status word holds two kinds of bits:
+ *  - levels: connection state (low nibble) and profile connections.
+ *    These are XORed with the previous status.
+ *  - events: track change, volume change etc. The RN52 clears these when
+ *    the status is read, so a set bit is a new event even if it was also
+ *    set last time.
+ */
+class Rn52StatusTracker {
+public:
+    using Flags = Libp::Rn52::StatusFlags;
+
+    static constexpr uint16_t state_mask = 0x000f;
+    static constexpr uint16_t profile_mask =
+            statusBit(Flags::active_con_iap) | statusBit(Flags::active_con_spp)
+          | statusBit(Flags::active_con_a2dp) | statusBit(Flags::active_con_hfphsp);
+    static constexpr uint16_t event_mask =
+            statusBit(Flags::caller_id_event) | statusBit(Flags::track_change_event)
+          | statusBit(Flags::audio_vol_change_event) | statusBit(Flags::microphone_vol_change_event);
+
+    struct Delta {
+        uint16_t changed; ///< level bits that differ from the last status
+        uint16_t events;  ///< event bits set in this status
+
+        bool empty() const
+        {
+            return changed == 0 && events == 0;
+        }
+    };
+
+    Delta update(uint16_t status)
+    {
+        const Delta delta = {
+            static_cast<uint16_t>((status ^ last_) & (state_mask | profile_mask)),
+            static_cast<uint16_t>(status & event_mask)
+        };
+        last_ = status;
+        return delta;
+    }
+
+    uint16_t last() const
+    {
+        return last_;
+    }
+
+    /// Module was power cycled, the next status is all new
+    void reset()
+    {
+        last_ = 0;
+    }
+
+private:
+    uint16_t last_ = 0;
+};
+
+#endif /* SRC_RN52_STATUS_H_ */
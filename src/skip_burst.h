@@ -0,0 +1,79 @@
+#ifndef SRC_SKIP_BURST_H_
+#define SRC_SKIP_BURST_H_
+
+#include <cstdint>
+#include <algorithm>
+#include <error_handler.h>
+
+/**
+ * Coalesces track skip presses into net skips.
+ *
+ * The first press of a burst is sent straight away. Presses within the
+ * burst window add to a net count (next +1, prev -1) that is sent when the
+ * window ends, at most `max_per_round` at a time so the RN52 command queue
+ * and the phone aren't flooded. The rest is carried over to the next
+ * round, so no press is lost.
+ */
+class SkipBurst {
+public:
+    /// Most skips sent at the end of one window
+    static constexpr uint8_t max_per_round = 3;
+
+    /**
+     * Skip pressed
+     *
+     * @param in_burst a burst window is running
+     * @return direction to send now, or 0 if it was added to the burst
+     */
+    int8_t press(int8_t direction, bool in_burst)
+    {
+        n_presses_++;
+        if (in_burst) {
+            pending_ = std::clamp(pending_ + direction, -INT16_MAX, INT16_MAX);
+            return 0;
+        }
+        n_sent_++;
+        return direction;
+    }
+
+    /**
+     * Burst window ended
+     *
+     * @return net skips to send now, at most `max_per_round` either way
+     */
+    int8_t takeRound()
+    {
+        const int8_t n = std::clamp<int16_t>(pending_, -max_per_round, max_per_round);
+        pending_ -= n;
+        n_sent_ += n < 0 ? -n : n;
+        return n;
+    }
+
+    /// Skips carried over to the next round
+    bool hasPending() const
+    {
+        return pending_ != 0;
+    }
+
+    uint32_t nPresses() const
+    {
+        return n_presses_;
+    }
+    uint32_t nSent() const
+    {
+        return n_sent_;
+    }
+
+    void reportStats()
+    {
+        getErrHndlr().report("Skips: %lu pressed, %lu sent\r\n", n_presses_, n_sent_);
+    }
+
+private:
+    /// Net skips (+next, -prev) not sent yet
+    int16_t pending_ = 0;
+    uint32_t n_presses_ = 0;
+    uint32_t n_sent_ = 0;
+};
+
+#endif /* SRC_SKIP_BURST_H_ */
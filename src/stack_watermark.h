@@ -0,0 +1,53 @@
+#ifndef SRC_STACK_WATERMARK_H_
+#define SRC_STACK_WATERMARK_H_
+
+#include <cstdint>
+#include <error_handler.h>
+
+// Uncomment to measure peak stack use. Compiles to nothing otherwise.
+//#define STACK_WATERMARK
+
+#ifdef STACK_WATERMARK
+
+// From the linker script: end of .bss, top of the stack
+extern "C" uint32_t _ebss;
+extern "C" uint32_t _estack;
+
+inline constexpr uint32_t stack_paint = 0xdeadbeef;
+
+/**
+ * Fill the unused stack with a pattern. Call first thing in `main`, the
+ * stack must not yet have grown past this frame.
+ */
+__attribute__((noinline))
+inline void paintStack()
+{
+    // Leave room for this frame
+    uint32_t* const sp = static_cast<uint32_t*>(__builtin_frame_address(0)) - 16;
+    for (uint32_t* word = &_ebss; word < sp; word++)
+        *word = stack_paint;
+}
+
+/// @return peak stack use in bytes since `paintStack`
+inline uint32_t stackHighWater()
+{
+    const uint32_t* word = &_ebss;
+    while (word < &_estack && *word == stack_paint)
+        word++;
+    return (&_estack - word) * sizeof(uint32_t);
+}
+
+inline void reportStackHighWater()
+{
+    getErrHndlr().report("Stack high water: %lu of %lu bytes\r\n",
+            stackHighWater(), static_cast<unsigned long>((&_estack - &_ebss) * sizeof(uint32_t)));
+}
+
+#else
+
+inline void paintStack() { }
+inline void reportStackHighWater() { }
+
+#endif
+
+#endif /* SRC_STACK_WATERMARK_H_ */
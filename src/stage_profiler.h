@@ -0,0 +1,109 @@
+#ifndef SRC_STAGE_PROFILER_H_
+#define SRC_STAGE_PROFILER_H_
+
+#include <cstdint>
+#include <libpekin.h>
+#include <cycle_counter.h>
+#include <latency_histogram.h>
+#include <error_handler.h>
+
+// Uncomment to profile main loop stages. Compiles to nothing otherwise.
+//#define PROFILE_STAGES
+
+/// Main loop stages
+enum class Stage : uint8_t {
+    process_event,  ///< event dispatch
+    display_update, ///< animation frames + flush
+    brightness,     ///< ALS read + OLED brightness
+    sensor_read,    ///< BME280 read + clock draw
+    idle,           ///< waiting for the next event/timer
+};
+
+/// labels for serial debugging
+inline const char* stage_names[] = {
+    "process_event",
+    "display_update",
+    "brightness",
+    "sensor_read",
+    "idle",
+};
+inline constexpr uint8_t n_stages = sizeof(stage_names) / sizeof(stage_names[0]);
+
+#ifdef PROFILE_STAGES
+
+/**
+ * Tracks min/avg/max cycles and a log2 histogram per main loop stage.
+ */
+class StageProfiler {
+public:
+    /// Times a stage for the lifetime of the object
+    class Scope {
+    public:
+        Scope(StageProfiler& profiler, Stage stage)
+                : profiler_(profiler), stage_(stage), start_cycles_(cycleCount()) { }
+        ~Scope()
+        {
+            profiler_.record(stage_, cycleCount() - start_cycles_);
+        }
+    private:
+        StageProfiler& profiler_;
+        const Stage stage_;
+        const uint32_t start_cycles_;
+    };
+
+    void record(Stage stage, uint32_t cycles)
+    {
+        StageStats& stats = stats_[Libp::enumBaseT(stage)];
+        if (stats.histogram.count() == 0 || cycles < stats.min_cycles)
+            stats.min_cycles = cycles;
+        if (cycles > stats.max_cycles)
+            stats.max_cycles = cycles;
+        stats.total_cycles += cycles;
+        stats.histogram.record(cyclesToUs(cycles));
+    }
+
+    /// Print the stage breakdown to the debug UART
+    void report() const
+    {
+        for (uint8_t i = 0; i < n_stages; i++) {
+            const StageStats& stats = stats_[i];
+            const uint32_t n = stats.histogram.count();
+            if (n == 0)
+                continue;
+            getErrHndlr().report("%s: min %lu avg %lu max %lu cycles\r\n",
+                    stage_names[i], stats.min_cycles,
+                    static_cast<uint32_t>(stats.total_cycles / n), stats.max_cycles);
+            stats.histogram.report(stage_names[i]);
+        }
+    }
+
+    struct StageStats {
+        uint32_t min_cycles;
+        uint32_t max_cycles;
+        uint64_t total_cycles;
+        LatencyHistogram histogram;
+    };
+
+    const StageStats& stats(Stage stage) const
+    {
+        return stats_[Libp::enumBaseT(stage)];
+    }
+
+private:
+    StageStats stats_[n_stages] = {};
+};
+
+#else
+
+class StageProfiler {
+public:
+    class Scope {
+    public:
+        Scope(StageProfiler&, Stage) { }
+    };
+    void report() const { }
+};
+
+#endif
+
+#endif /* SRC_STAGE_PROFILER_H_ */
@@ -0,0 +1,72 @@
+#ifndef SRC_TEMP_SCHEDULE_H_
+#define SRC_TEMP_SCHEDULE_H_
+
+#include <cstdint>
+
+/**
+ * Decides what a clock tick does about the BME280 reading.
+ *
+ * A forced measurement is started after each reading, so by the next tick
+ * the sensor has finished and gone back to sleep with the result held in
+ * its registers: the tick only reads them. A measurement is started at the
+ * tick itself only when there is none, or it's too old to show.
+ */
+class TempSchedule {
+public:
+    /// A measurement older than this isn't shown, e.g. from before a
+    /// connection
+    static constexpr uint32_t max_age_ms = 90'000;
+
+    enum class Action : uint8_t {
+        read,  ///< result is ready
+        wait,  ///< measurement still running, read after `msToResult`
+        start, ///< start a measurement and read it after the measure time
+    };
+
+    /// Device woke, nothing measured yet
+    void wake(uint32_t now_ms)
+    {
+        wake_ms_ = now_ms;
+        started_ = false;
+    }
+
+    /// Measurement started
+    void started(uint32_t now_ms)
+    {
+        started_ = true;
+        start_ms_ = now_ms;
+    }
+
+    /// Clock tick, with the sensor taking `measure_ms` per measurement
+    Action tick(uint32_t now_ms, uint16_t measure_ms) const
+    {
+        const uint32_t age = now_ms - start_ms_;
+        if (!started_ || age > max_age_ms)
+            return Action::start;
+        // Tick came early, e.g. leaving the menu
+        if (age < measure_ms)
+            return Action::wait;
+        return Action::read;
+    }
+
+    /// @return ms until the measurement in progress is done
+    uint32_t msToResult(uint32_t now_ms, uint16_t measure_ms) const
+    {
+        const uint32_t age = now_ms - start_ms_;
+        return age < measure_ms ? measure_ms - age : 0;
+    }
+
+    /// Seconds since wake when the measurement started, for the self
+    /// heating compensation in `readTemp`
+    uint32_t secsActive() const
+    {
+        return (start_ms_ - wake_ms_) / 1000;
+    }
+
+private:
+    uint32_t wake_ms_ = 0;
+    bool started_ = false;
+    uint32_t start_ms_ = 0;
+};
+
+#endif /* SRC_TEMP_SCHEDULE_H_ */
@@ -0,0 +1,92 @@
+#include <timer_service.h>
+
+using namespace Libp;
+
+void TimerService::start(TimerId id, uint32_t delay_ms, uint32_t period_ms)
+{
+    const uint8_t idx = enumBaseT(id);
+    Timer& timer = timers_[idx];
+    timer.expiry_ms = getMillis() + delay_ms;
+    timer.period_ms = period_ms;
+
+    uint8_t pos = heap_pos_[idx];
+    if (pos == not_in_heap) {
+        pos = n_active_++;
+        place(pos, idx);
+    }
+    // New expiry may be earlier or later than before
+    siftUp(pos);
+    siftDown(heap_pos_[idx]);
+}
+
+void TimerService::stop(TimerId id)
+{
+    const uint8_t pos = heap_pos_[enumBaseT(id)];
+    if (pos != not_in_heap)
+        removeAt(pos);
+}
+
+void TimerService::processExpired(uint32_t now_ms)
+{
+    while (n_active_ && static_cast<int32_t>(now_ms - timers_[heap_[0]].expiry_ms) >= 0) {
+        const uint8_t idx = heap_[0];
+        Timer& timer = timers_[idx];
+        if (timer.period_ms) {
+            timer.expiry_ms += timer.period_ms;
+            // Don't try to catch up on missed periods
+            if (static_cast<int32_t>(now_ms - timer.expiry_ms) >= 0)
+                timer.expiry_ms = now_ms + timer.period_ms;
+            siftDown(0);
+        }
+        else {
+            removeAt(0);
+        }
+        // Fire last so the callback can restart/stop timers
+        if (timer.callback)
+            timer.callback(timer.ctx);
+        else
+            event_queue_.postEvent(timer.event);
+    }
+}
+
+void TimerService::siftUp(uint8_t pos)
+{
+    const uint8_t idx = heap_[pos];
+    while (pos > 0) {
+        const uint8_t parent = (pos - 1) / 2;
+        if (!earlier(idx, heap_[parent]))
+            break;
+        place(pos, heap_[parent]);
+        pos = parent;
+    }
+    place(pos, idx);
+}
+
+void TimerService::siftDown(uint8_t pos)
+{
+    const uint8_t idx = heap_[pos];
+    while (true) {
+        uint8_t child = pos * 2 + 1;
+        if (child >= n_active_)
+            break;
+        if (child + 1 < n_active_ && earlier(heap_[child + 1], heap_[child]))
+            child++;
+        if (!earlier(heap_[child], idx))
+            break;
+        place(pos, heap_[child]);
+        pos = child;
+    }
+    place(pos, idx);
+}
+
+void TimerService::removeAt(uint8_t pos)
+{
+    heap_pos_[heap_[pos]] = not_in_heap;
+    n_active_--;
+    if (pos == n_active_)
+        return;
+    const uint8_t moved = heap_[n_active_];
+    place(pos, moved);
+    siftUp(pos);
+    siftDown(heap_pos_[moved]);
+}
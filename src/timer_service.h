@@ -0,0 +1,131 @@
+#ifndef SRC_TIMER_SERVICE_H_
+#define SRC_TIMER_SERVICE_H_
+
+#include <cstdint>
+#include <algorithm>
+#include <iterator>
+#include <event_queue.h>
+
+/// Software timers. One statically allocated timer per id.
+enum class TimerId : uint8_t {
+    animation,    ///< next animation frame due
+    brightness,   ///< ambient light -> OLED brightness update
+    inactivity,   ///< sleep after inactivity
+    stats_window, ///< per minute statistics window
+    sensor_read,  ///< BME280 measurement complete
+    menu_message, ///< menu confirmation message shown long enough
+    rn52_boot,    ///< poll for RN52 boot completion after wake
+    feedback,     ///< unconfirmed button feedback rolled back
+    skip_burst,   ///< track skip presses coalesced, send them
+    track_settle, ///< track changes settled, fetch metadata
+    rn52_cmd,     ///< RN52 command response timeout
+    volume_bar,   ///< volume bar shown long enough
+    progress,     ///< progress bar due to grow a pixel, keep last
+};
+inline constexpr uint8_t n_timers = static_cast<uint8_t>(TimerId::progress) + 1;
+
+/**
+ * Software timer service for the main loop.
+ *
+ * Timers are one-shot or periodic and on expiry either post an event or
+ * invoke a callback. Active timers are kept in a binary min-heap on expiry
+ * time so the next expiry is available in O(1) and start/stop are
+ * O(log n).
+ *
+ * Not irq safe - all calls, including callbacks, happen in the main loop.
+ */
+class TimerService {
+public:
+    using Callback = void (*)(void* ctx);
+    static constexpr uint32_t never = UINT32_MAX;
+
+    TimerService(EventQueue& event_queue) : event_queue_(event_queue)
+    {
+        std::fill(std::begin(heap_pos_), std::end(heap_pos_), not_in_heap);
+    }
+
+    /// Invoke `callback(ctx)` when timer `id` expires
+    void setCallback(TimerId id, Callback callback, void* ctx)
+    {
+        Timer& timer = timers_[Libp::enumBaseT(id)];
+        timer.callback = callback;
+        timer.ctx = ctx;
+    }
+
+    /// Post `type` when timer `id` expires
+    void setEvent(TimerId id, EventType type)
+    {
+        Timer& timer = timers_[Libp::enumBaseT(id)];
+        timer.callback = nullptr;
+        timer.event = type;
+    }
+
+    /// (Re)start a timer to expire once after `delay_ms`
+    void startOneShot(TimerId id, uint32_t delay_ms)
+    {
+        start(id, delay_ms, 0);
+    }
+
+    /// (Re)start a timer to expire every `period_ms`
+    void startPeriodic(TimerId id, uint32_t period_ms)
+    {
+        start(id, period_ms, period_ms);
+    }
+
+    void stop(TimerId id);
+
+    bool isActive(TimerId id) const
+    {
+        return heap_pos_[Libp::enumBaseT(id)] != not_in_heap;
+    }
+
+    /// @return ms until the earliest active timer expires, or `never`
+    uint32_t msToNextExpiry(uint32_t now_ms) const
+    {
+        if (n_active_ == 0)
+            return never;
+        const int32_t ms = timers_[heap_[0]].expiry_ms - now_ms;
+        return ms < 0 ? 0 : ms;
+    }
+
+    /// Fire all timers that have expired by `now_ms`
+    void processExpired(uint32_t now_ms);
+
+private:
+    static constexpr uint8_t not_in_heap = 0xff;
+
+    struct Timer {
+        uint32_t expiry_ms;
+        uint32_t period_ms; ///< 0 for one-shot
+        Callback callback;
+        void* ctx;
+        EventType event;
+    };
+
+    EventQueue& event_queue_;
+    Timer timers_[n_timers] = {};
+
+    /// Min-heap of timer indices ordered by expiry
+    uint8_t heap_[n_timers];
+    /// Position of each timer in heap_ or not_in_heap
+    uint8_t heap_pos_[n_timers];
+    uint8_t n_active_ = 0;
+
+    void start(TimerId id, uint32_t delay_ms, uint32_t period_ms);
+
+    /// Wraparound safe `timers_[a].expiry_ms < timers_[b].expiry_ms`
+    bool earlier(uint8_t a, uint8_t b) const
+    {
+        return static_cast<int32_t>(timers_[a].expiry_ms - timers_[b].expiry_ms) < 0;
+    }
+    void place(uint8_t pos, uint8_t idx)
+    {
+        heap_[pos] = idx;
+        heap_pos_[idx] = pos;
+    }
+    void siftUp(uint8_t pos);
+    void siftDown(uint8_t pos);
+    void removeAt(uint8_t pos);
+};
+
+#endif /* SRC_TIMER_SERVICE_H_ */
@@ -0,0 +1,55 @@
+#ifndef SRC_TRACK_CACHE_H_
+#define SRC_TRACK_CACHE_H_
+
+#include <cstdint>
+#include <error_handler.h>
+
+/**
+ * Remembers whether the display's `TrackInfo` still describes the track
+ * the RN52 is playing, so pause/resume can redraw without an AVRCP query.
+ *
+ * The RN52 only reports that the track changed, not which track is
+ * playing, so the cache is a single valid flag: set when metadata is
+ * fetched and cleared on a track change.
+ */
+class TrackCache {
+public:
+    /// Metadata for the current track has just been fetched
+    void store()
+    {
+        valid_ = true;
+    }
+
+    /// RN52 reported a track change, or the source went away
+    void invalidate()
+    {
+        valid_ = false;
+    }
+
+    /**
+     * Playback (re)started
+     *
+     * @return true if the stored metadata can be used as is
+     */
+    bool lookup()
+    {
+        if (valid_)
+            n_hits_++;
+        else
+            n_misses_++;
+        return valid_;
+    }
+
+    void reportStats()
+    {
+        getErrHndlr().report("Track cache: %lu hits, %lu misses\r\n", n_hits_, n_misses_);
+    }
+
+private:
+    bool valid_ = false;
+
+    uint32_t n_hits_ = 0;
+    uint32_t n_misses_ = 0;
+};
+
+#endif /* SRC_TRACK_CACHE_H_ */
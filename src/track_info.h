@@ -0,0 +1,107 @@
+#ifndef SRC_TRACK_INFO_H_
+#define SRC_TRACK_INFO_H_
+
+#include <cstdint>
+
+/// AVRCP metadata fields, in the order the RN52 sends them
+enum class TrackField : uint8_t {
+    title, artist, album, track_number, track_count, genre, duration
+};
+inline constexpr uint8_t n_track_fields = 7;
+
+/// Bit for `field` in a field mask
+inline constexpr uint8_t trackFieldBit(TrackField field)
+{
+    return 1u << static_cast<uint8_t>(field);
+}
+
+/**
+ * Metadata for the current track. Owned by `Display` and written in place
+ * by `MetadataParser`.
+ *
+ * Only the text fields that are shown, title and artist, are stored. They
+ * share one arena and are referenced by (offset, length) views, each
+ * null terminated at all times. Longer values are truncated.
+ */
+class TrackInfo {
+public:
+    /// Longest text that can be shown, see `Display::meta_text_max_chars`
+    static constexpr uint8_t max_text_len = 55;
+    /// `trimText` may replace the last character with "..."
+    static constexpr uint8_t trim_slack = 2;
+
+    uint16_t track_number = 0;
+    uint16_t track_count = 0;
+    uint32_t duration_ms = 0;
+
+    /// @return true if `field` is stored
+    static constexpr bool hasText(TrackField field)
+    {
+        return field == TrackField::title || field == TrackField::artist;
+    }
+
+    /// Null terminated, empty if not received
+    const char* text(TrackField field) const
+    {
+        return arena_ + views_[viewIdx(field)].offset;
+    }
+    /// For shortening in place, by at most `trim_slack` characters more
+    char* text(TrackField field)
+    {
+        return arena_ + views_[viewIdx(field)].offset;
+    }
+
+    /// Start `field`'s text after those already written, must be `hasText`
+    void beginText(TrackField field)
+    {
+        View& view = views_[viewIdx(field)];
+        if (view.offset != 0) {
+            // Field sent twice, keep the first value. Each field therefore
+            // takes at most one slot of the arena.
+            writing_ = nullptr;
+            return;
+        }
+        view = { used_, 0 };
+        arena_[used_] = '\0';
+        writing_ = &view;
+    }
+    /// Append to the text begun last, truncating at `max_text_len`
+    void appendText(char c)
+    {
+        if (writing_ == nullptr || writing_->len == max_text_len)
+            return;
+        char* end = arena_ + writing_->offset + writing_->len++;
+        end[0] = c;
+        end[1] = '\0';
+    }
+    void endText()
+    {
+        if (writing_ != nullptr)
+            used_ += writing_->len + 1 + trim_slack;
+        writing_ = nullptr;
+    }
+
+private:
+    static constexpr uint8_t n_text_fields = 2;
+    static constexpr uint8_t slot_len = max_text_len + 1 + trim_slack;
+    /// Offset 0 is the empty string for fields not received
+    static constexpr uint8_t arena_len = 1 + n_text_fields * slot_len;
+    static_assert(arena_len <= UINT8_MAX);
+
+    struct View {
+        uint8_t offset;
+        uint8_t len;
+    };
+
+    char arena_[arena_len] = {};
+    View views_[n_text_fields] = {};
+    uint8_t used_ = 1;
+    View* writing_ = nullptr;
+
+    static constexpr uint8_t viewIdx(TrackField field)
+    {
+        return field == TrackField::artist ? 1 : 0;
+    }
+};
+
+#endif /* SRC_TRACK_INFO_H_ */
@@ -0,0 +1,128 @@
+#include <algorithm>
+#include <iterator>
+#include <utf8.h>
+
+namespace {
+
+struct Translit {
+    uint16_t code_point;
+    char ascii[4];
+};
+
+/// Sorted by code point for binary search. Derived from the NFKD
+/// decomposition with combining marks removed, letters without one spelt
+/// out by hand.
+constexpr Translit translit_table[] = {
+    { 0x00a0, " " }, { 0x00a1, "!" }, { 0x00a2, "c" }, { 0x00a3, "L" },
+    { 0x00a4, "$" }, { 0x00a5, "Y" }, { 0x00a6, "|" }, { 0x00a7, "S" },
+    { 0x00a8, "\"" }, { 0x00a9, "C" }, { 0x00aa, "a" }, { 0x00ab, "<<" },
+    { 0x00ac, "-" }, { 0x00ad, "-" }, { 0x00ae, "R" }, { 0x00af, "-" },
+    { 0x00b0, "o" }, { 0x00b1, "+-" }, { 0x00b2, "2" }, { 0x00b3, "3" },
+    { 0x00b4, "'" }, { 0x00b5, "u" }, { 0x00b6, "P" }, { 0x00b7, "." },
+    { 0x00b8, "," }, { 0x00b9, "1" }, { 0x00ba, "o" }, { 0x00bb, ">>" },
+    { 0x00bf, "?" }, { 0x00c0, "A" }, { 0x00c1, "A" }, { 0x00c2, "A" },
+    { 0x00c3, "A" }, { 0x00c4, "A" }, { 0x00c5, "A" }, { 0x00c6, "AE" },
+    { 0x00c7, "C" }, { 0x00c8, "E" }, { 0x00c9, "E" }, { 0x00ca, "E" },
+    { 0x00cb, "E" }, { 0x00cc, "I" }, { 0x00cd, "I" }, { 0x00ce, "I" },
+    { 0x00cf, "I" }, { 0x00d0, "D" }, { 0x00d1, "N" }, { 0x00d2, "O" },
+    { 0x00d3, "O" }, { 0x00d4, "O" }, { 0x00d5, "O" }, { 0x00d6, "O" },
+    { 0x00d7, "x" }, { 0x00d8, "O" }, { 0x00d9, "U" }, { 0x00da, "U" },
+    { 0x00db, "U" }, { 0x00dc, "U" }, { 0x00dd, "Y" }, { 0x00de, "TH" },
+    { 0x00df, "ss" }, { 0x00e0, "a" }, { 0x00e1, "a" }, { 0x00e2, "a" },
+    { 0x00e3, "a" }, { 0x00e4, "a" }, { 0x00e5, "a" }, { 0x00e6, "ae" },
+    { 0x00e7, "c" }, { 0x00e8, "e" }, { 0x00e9, "e" }, { 0x00ea, "e" },
+    { 0x00eb, "e" }, { 0x00ec, "i" }, { 0x00ed, "i" }, { 0x00ee, "i" },
+    { 0x00ef, "i" }, { 0x00f0, "d" }, { 0x00f1, "n" }, { 0x00f2, "o" },
+    { 0x00f3, "o" }, { 0x00f4, "o" }, { 0x00f5, "o" }, { 0x00f6, "o" },
+    { 0x00f7, "/" }, { 0x00f8, "o" }, { 0x00f9, "u" }, { 0x00fa, "u" },
+    { 0x00fb, "u" }, { 0x00fc, "u" }, { 0x00fd, "y" }, { 0x00fe, "th" },
+    { 0x00ff, "y" }, { 0x0100, "A" }, { 0x0101, "a" }, { 0x0102, "A" },
+    { 0x0103, "a" }, { 0x0104, "A" }, { 0x0105, "a" }, { 0x0106, "C" },
+    { 0x0107, "c" }, { 0x0108, "C" }, { 0x0109, "c" }, { 0x010a, "C" },
+    { 0x010b, "c" }, { 0x010c, "C" }, { 0x010d, "c" }, { 0x010e, "D" },
+    { 0x010f, "d" }, { 0x0110, "D" }, { 0x0111, "d" }, { 0x0112, "E" },
+    { 0x0113, "e" }, { 0x0114, "E" }, { 0x0115, "e" }, { 0x0116, "E" },
+    { 0x0117, "e" }, { 0x0118, "E" }, { 0x0119, "e" }, { 0x011a, "E" },
+    { 0x011b, "e" }, { 0x011c, "G" }, { 0x011d, "g" }, { 0x011e, "G" },
+    { 0x011f, "g" }, { 0x0120, "G" }, { 0x0121, "g" }, { 0x0122, "G" },
+    { 0x0123, "g" }, { 0x0124, "H" }, { 0x0125, "h" }, { 0x0126, "H" },
+    { 0x0127, "h" }, { 0x0128, "I" }, { 0x0129, "i" }, { 0x012a, "I" },
+    { 0x012b, "i" }, { 0x012c, "I" }, { 0x012d, "i" }, { 0x012e, "I" },
+    { 0x012f, "i" }, { 0x0130, "I" }, { 0x0131, "i" }, { 0x0132, "IJ" },
+    { 0x0133, "ij" }, { 0x0134, "J" }, { 0x0135, "j" }, { 0x0136, "K" },
+    { 0x0137, "k" }, { 0x0138, "q" }, { 0x0139, "L" }, { 0x013a, "l" },
+    { 0x013b, "L" }, { 0x013c, "l" }, { 0x013d, "L" }, { 0x013e, "l" },
+    { 0x013f, "L" }, { 0x0140, "l" }, { 0x0141, "L" }, { 0x0142, "l" },
+    { 0x0143, "N" }, { 0x0144, "n" }, { 0x0145, "N" }, { 0x0146, "n" },
+    { 0x0147, "N" }, { 0x0148, "n" }, { 0x0149, "n" }, { 0x014a, "N" },
+    { 0x014b, "n" }, { 0x014c, "O" }, { 0x014d, "o" }, { 0x014e, "O" },
+    { 0x014f, "o" }, { 0x0150, "O" }, { 0x0151, "o" }, { 0x0152, "OE" },
+    { 0x0153, "oe" }, { 0x0154, "R" }, { 0x0155, "r" }, { 0x0156, "R" },
+    { 0x0157, "r" }, { 0x0158, "R" }, { 0x0159, "r" }, { 0x015a, "S" },
+    { 0x015b, "s" }, { 0x015c, "S" }, { 0x015d, "s" }, { 0x015e, "S" },
+    { 0x015f, "s" }, { 0x0160, "S" }, { 0x0161, "s" }, { 0x0162, "T" },
+    { 0x0163, "t" }, { 0x0164, "T" }, { 0x0165, "t" }, { 0x0166, "T" },
+    { 0x0167, "t" }, { 0x0168, "U" }, { 0x0169, "u" }, { 0x016a, "U" },
+    { 0x016b, "u" }, { 0x016c, "U" }, { 0x016d, "u" }, { 0x016e, "U" },
+    { 0x016f, "u" }, { 0x0170, "U" }, { 0x0171, "u" }, { 0x0172, "U" },
+    { 0x0173, "u" }, { 0x0174, "W" }, { 0x0175, "w" }, { 0x0176, "Y" },
+    { 0x0177, "y" }, { 0x0178, "Y" }, { 0x0179, "Z" }, { 0x017a, "z" },
+    { 0x017b, "Z" }, { 0x017c, "z" }, { 0x017d, "Z" }, { 0x017e, "z" },
+    { 0x017f, "s" }, { 0x2010, "-" }, { 0x2011, "-" }, { 0x2012, "-" },
+    { 0x2013, "-" }, { 0x2014, "-" }, { 0x2015, "-" }, { 0x2018, "'" },
+    { 0x2019, "'" }, { 0x201a, "," }, { 0x201c, "\"" }, { 0x201d, "\"" },
+    { 0x201e, "\"" }, { 0x2022, "*" }, { 0x2026, "..." }, { 0x2032, "'" },
+    { 0x2033, "\"" }, { 0x20ac, "E" },
+};
+
+constexpr bool isSorted()
+{
+    for (size_t i = 1; i < std::size(translit_table); i++) {
+        if (translit_table[i - 1].code_point >= translit_table[i].code_point)
+            return false;
+    }
+    return true;
+}
+static_assert(isSorted());
+
+}
+
+uint32_t Utf8Decoder::feed(uint8_t byte)
+{
+    if (n_remaining_ > 0) {
+        if ((byte & 0xc0) == 0x80) {
+            code_point_ = (code_point_ << 6) | (byte & 0x3f);
+            return --n_remaining_ == 0 ? code_point_ : none;
+        }
+        // Truncated sequence is dropped, this byte starts afresh
+        n_remaining_ = 0;
+    }
+    if (byte < 0x80)
+        return byte;
+    // Lead bytes only, overlong forms aren't rejected
+    if ((byte & 0xe0) == 0xc0) {
+        code_point_ = byte & 0x1f;
+        n_remaining_ = 1;
+    }
+    else if ((byte & 0xf0) == 0xe0) {
+        code_point_ = byte & 0x0f;
+        n_remaining_ = 2;
+    }
+    else if ((byte & 0xf8) == 0xf0) {
+        code_point_ = byte & 0x07;
+        n_remaining_ = 3;
+    }
+    else
+        return invalid;
+    return none;
+}
+
+const char* transliterate(uint32_t code_point)
+{
+    const Translit* const end = std::end(translit_table);
+    const Translit* const it = std::lower_bound(std::begin(translit_table), end, code_point,
+            [](const Translit& entry, uint32_t cp) { return entry.code_point < cp; });
+    if (it == end || it->code_point != code_point)
+        return "?";
+    return it->ascii;
+}
@@ -0,0 +1,40 @@
+#ifndef SRC_UTF8_H_
+#define SRC_UTF8_H_
+
+#include <cstdint>
+
+/**
+ * Incremental UTF-8 decoder, fed a byte at a time so multi-byte sequences
+ * can be split across RX bursts.
+ *
+ * Stray continuation bytes and invalid lead bytes decode to `invalid`, a
+ * sequence cut short by the next lead byte is dropped.
+ */
+class Utf8Decoder {
+public:
+    static constexpr uint32_t none = UINT32_MAX;  ///< sequence incomplete
+    static constexpr uint32_t invalid = 0xfffd;   ///< replacement character
+
+    void reset()
+    {
+        n_remaining_ = 0;
+    }
+
+    /// @return code point ending with `byte`, or `none`
+    uint32_t feed(uint8_t byte);
+
+private:
+    uint32_t code_point_ = 0;
+    uint8_t n_remaining_ = 0;
+};
+
+/**
+ * ASCII replacement for a code point the font doesn't have: "e" for "é",
+ * "ss" for "ß", "?" if there is none, as for control characters. Covers
+ * Latin-1, Latin Extended-A and common typographic punctuation.
+ *
+ * @return 1 to 3 characters
+ */
+const char* transliterate(uint32_t code_point);
+
+#endif /* SRC_UTF8_H_ */
@@ -0,0 +1,99 @@
+#ifndef SRC_VOLUME_MODEL_H_
+#define SRC_VOLUME_MODEL_H_
+
+#include <cstdint>
+#include <algorithm>
+#include <error_handler.h>
+
+/**
+ * Local estimate of the RN52 speaker volume, 0 to `max_level` in AV+/AV-
+ * steps.
+ *
+ * The RN52 can't be asked for its volume and its volume change event
+ * carries no level, so the volume is tracked as a range [low, high] that
+ * holds the real level:
+ *  - AV+/AV- move both ends of the range, clamped to the limits. Pressing
+ *    against a limit therefore narrows the range down to the exact level.
+ *  - A volume change event not caused by our own commands (the phone
+ *    changed the volume) makes the level unknown again.
+ *
+ * Events are cleared when the status is read, so one event may stand for
+ * several of our steps. A phone change while our steps are still
+ * unconfirmed is missed, as is one just after a step that turned out to
+ * be against the limit.
+ */
+class VolumeModel {
+public:
+    static constexpr uint8_t max_level = 15;
+
+    uint8_t low() const
+    {
+        return low_;
+    }
+    uint8_t high() const
+    {
+        return high_;
+    }
+    bool isKnown() const
+    {
+        return low_ == high_;
+    }
+
+    /// AV+ sent
+    void stepUp()
+    {
+        step(1);
+    }
+    /// AV- sent
+    void stepDown()
+    {
+        step(-1);
+    }
+
+    /// RN52 reported a volume change
+    void notifyChanged()
+    {
+        if (n_unconfirmed_ > 0) {
+            n_unconfirmed_ = 0;
+            return;
+        }
+        n_external_++;
+        forget();
+    }
+
+    /// New source connected, it may have set its own volume
+    void forget()
+    {
+        low_ = 0;
+        high_ = max_level;
+        n_unconfirmed_ = 0;
+    }
+
+    void reportStats()
+    {
+        getErrHndlr().report("Volume: %u..%u, %lu external changes\r\n",
+                low_, high_, n_external_);
+    }
+
+private:
+    uint8_t low_ = 0;
+    uint8_t high_ = max_level;
+    /// Steps sent that the RN52 hasn't reported yet
+    uint8_t n_unconfirmed_ = 0;
+    uint32_t n_external_ = 0;
+
+    void step(int8_t dir)
+    {
+        const uint8_t low = std::clamp(low_ + dir, 0, int(max_level));
+        const uint8_t high = std::clamp(high_ + dir, 0, int(max_level));
+        // Count steps that may have changed the level, none is reported
+        // for a step against the limit
+        const bool may_change = dir > 0 ? low != low_ : high != high_;
+        if (may_change && n_unconfirmed_ < UINT8_MAX)
+            n_unconfirmed_++;
+        low_ = low;
+        high_ = high;
+    }
+};
+
+#endif /* SRC_VOLUME_MODEL_H_ */
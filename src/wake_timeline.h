@@ -0,0 +1,72 @@
+#ifndef SRC_WAKE_TIMELINE_H_
+#define SRC_WAKE_TIMELINE_H_
+
+#include <cstdint>
+#include <error_handler.h>
+
+/// Milestones after a wake from sleep, in the order they normally happen
+enum class WakeMark : uint8_t {
+    rn52_booted,     ///< "CMD" received
+    reconnect_sent,  ///< reconnect to the last phone requested
+    connected,       ///< phone connected
+    streaming,       ///< audio streaming
+};
+
+/// labels for serial debugging
+inline const char* wake_mark_names[] = {
+    "rn52_booted",
+    "reconnect_sent",
+    "connected",
+    "streaming",
+};
+inline constexpr uint8_t n_wake_marks = sizeof(wake_mark_names) / sizeof(wake_mark_names[0]);
+
+/**
+ * Time from wake to each milestone, first occurrence only. Reported on the
+ * debug UART once streaming starts.
+ */
+class WakeTimeline {
+public:
+    static constexpr uint32_t never = UINT32_MAX;
+
+    void start(uint32_t now_ms)
+    {
+        wake_ms_ = now_ms;
+        reached_ = 0;
+    }
+
+    void mark(WakeMark mark, uint32_t now_ms)
+    {
+        const uint8_t idx = static_cast<uint8_t>(mark);
+        if (reached_ & (1u << idx))
+            return;
+        reached_ |= 1u << idx;
+        at_ms_[idx] = now_ms - wake_ms_;
+        if (mark == WakeMark::streaming)
+            report();
+    }
+
+    /// @return ms from wake to `mark`, or `never` if not reached yet
+    uint32_t msTo(WakeMark mark) const
+    {
+        const uint8_t idx = static_cast<uint8_t>(mark);
+        return reached_ & (1u << idx) ? at_ms_[idx] : never;
+    }
+
+    void report()
+    {
+        getErrHndlr().report("Wake timeline:");
+        for (uint8_t i = 0; i < n_wake_marks; i++) {
+            if (reached_ & (1u << i))
+                getErrHndlr().report(" %s +%lu ms", wake_mark_names[i], at_ms_[i]);
+        }
+        getErrHndlr().report("\r\n");
+    }
+
+private:
+    uint32_t wake_ms_ = 0;
+    uint32_t at_ms_[n_wake_marks] = {};
+    uint8_t reached_ = 0;
+};
+
+#endif /* SRC_WAKE_TIMELINE_H_ */
@@ -0,0 +1,15 @@
+#ifndef TEST_NATIVE_STUBS_DEVICES_PERIPHERALS_H_
+#define TEST_NATIVE_STUBS_DEVICES_PERIPHERALS_H_
+
+#include <cstdint>
+
+/// Host stand-in for src/devices/peripherals.h, constants and irq masking
+
+inline constexpr uint32_t btn_and_rn52_irq_priority = 1;
+inline constexpr uint32_t btn_sample_period_us = 2000;
+
+/// Tests run single threaded, nothing to mask
+inline void disableExtIrqs() { }
+inline void enableExtIrqs(bool clear_first = true) { }
+
+#endif /* TEST_NATIVE_STUBS_DEVICES_PERIPHERALS_H_ */
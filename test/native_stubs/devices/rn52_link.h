@@ -0,0 +1,177 @@
+#ifndef TEST_NATIVE_STUBS_DEVICES_RN52_LINK_H_
+#define TEST_NATIVE_STUBS_DEVICES_RN52_LINK_H_
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <string>
+#include <libpekin.h>
+
+/**
+ * Host stand-in for the USART1 link to the RN52, same interface as
+ * src/devices/rn52_link.h.
+ *
+ * Commands written are handed to `on_command` as they end with CR, which
+ * plays the module and answers with `reply`. Replies arrive on the host
+ * clock, `Libp::host_ms`, after the wire time at `peer_baud` and are
+ * garbled if our rate differs, as are commands sent at the wrong rate.
+ */
+class Rn52Link {
+public:
+    static constexpr uint32_t default_baud = 115200;
+    static constexpr uint32_t fast_baud = 460800;
+
+    static constexpr uint16_t rx_buf_len = 512;
+    static constexpr uint16_t max_line_len = 128;
+
+    using RxCallback = void (*)();
+
+    /// Module side: a command without its CR
+    std::function<void(const std::string& cmd)> on_command;
+    /// Rate the module is at
+    uint32_t peer_baud = default_baud;
+    /// Module's delay before it starts to answer
+    uint32_t turnaround_ms = 1;
+    /// Everything written, at any rate
+    std::string tx_log;
+    uint32_t n_bytes_written = 0;
+    uint32_t n_bytes_received = 0;
+
+    void start(uint32_t baud)
+    {
+        baud_ = baud;
+        discard();
+    }
+
+    void setBaud(uint32_t baud)
+    {
+        start(baud);
+    }
+    uint32_t baud() const
+    {
+        return baud_;
+    }
+
+    void setRxCallback(RxCallback callback)
+    {
+        rx_callback_ = callback;
+    }
+
+    void write(const char* str)
+    {
+        for (; *str; str++) {
+            tx_log += *str;
+            n_bytes_written++;
+            if (*str != '\r') {
+                cmd_ += *str;
+                continue;
+            }
+            const std::string cmd = cmd_;
+            cmd_.clear();
+            // The module sees framing errors at the wrong rate
+            if (baud_ == peer_baud && on_command)
+                on_command(cmd);
+        }
+    }
+
+    /// Module side: send `text` once the wire is free
+    void reply(const std::string& text)
+    {
+        const uint32_t now = Libp::host_ms;
+        const uint32_t start = pending_.empty() || now + turnaround_ms > pending_.back().due_ms
+                ? now + turnaround_ms : pending_.back().due_ms;
+        // 10 bits a byte, rounded up
+        const uint32_t wire_ms = (text.size() * 10'000 + peer_baud - 1) / peer_baud;
+        pending_.push_back({ start + wire_ms, peer_baud, text });
+    }
+
+    bool readLine(const char*& line)
+    {
+        receive();
+        while (true) {
+            const size_t end = rx_.find('\n', rx_read_);
+            if (end == std::string::npos)
+                return false;
+            line_ = rx_.substr(rx_read_, end - rx_read_);
+            rx_read_ = end + 1;
+            if (!line_.empty() && line_.back() == '\r')
+                line_.pop_back();
+            if (line_.size() > max_line_len)
+                line_.resize(max_line_len);
+            if (line_.empty())
+                continue;
+            line = line_.c_str();
+            return true;
+        }
+    }
+
+    uint16_t peek(const char*& data)
+    {
+        receive();
+        data = rx_.data() + rx_read_;
+        return rx_.size() - rx_read_;
+    }
+    void consume(uint16_t n)
+    {
+        rx_read_ += n;
+    }
+
+    bool awaitLine(const char*& line, uint32_t timeout_ms)
+    {
+        const uint32_t start = Libp::getMillis();
+        while (!readLine(line)) {
+            if (Libp::getMillis() - start >= timeout_ms)
+                return false;
+        }
+        return true;
+    }
+
+    /// Drops what has arrived, replies still on the wire come later
+    uint16_t discard()
+    {
+        receive();
+        const uint16_t n = rx_.size() - rx_read_;
+        rx_.clear();
+        rx_read_ = 0;
+        return n;
+    }
+
+    void serviceUsartIrq() { }
+    void serviceDmaIrq() { }
+    void reportStats() { }
+
+private:
+    struct Chunk {
+        uint32_t due_ms;
+        uint32_t baud;
+        std::string text;
+    };
+
+    uint32_t baud_ = 0;
+    RxCallback rx_callback_ = nullptr;
+    std::string cmd_;
+    std::deque<Chunk> pending_;
+    std::string rx_;
+    size_t rx_read_ = 0;
+    std::string line_;
+
+    /// Move replies that have arrived by now into the RX buffer
+    void receive()
+    {
+        while (!pending_.empty() && static_cast<int32_t>(Libp::host_ms - pending_.front().due_ms) >= 0) {
+            Chunk& chunk = pending_.front();
+            n_bytes_received += chunk.text.size();
+            if (chunk.baud != baud_) {
+                // Framing errors, no line endings survive
+                for (char& c : chunk.text)
+                    c = static_cast<char>(c | 0x80);
+            }
+            rx_ += chunk.text;
+            pending_.pop_front();
+            if (rx_callback_)
+                rx_callback_();
+        }
+    }
+};
+
+#endif /* TEST_NATIVE_STUBS_DEVICES_RN52_LINK_H_ */
@@ -0,0 +1,29 @@
+#ifndef TEST_NATIVE_STUBS_DRIVERS_WIRELESS_RN_52_H_
+#define TEST_NATIVE_STUBS_DRIVERS_WIRELESS_RN_52_H_
+
+#include <cstdint>
+
+namespace Libp {
+
+/// Host stand-in for the Libp RN52 driver, status word only
+class Rn52 {
+public:
+    /// Status returned when a "Q" query fails, no real status has all bits
+    static constexpr uint16_t query_status_error = 0xffff;
+
+    /// "Q" status word bits, see the RN52 user's guide
+    enum class StatusFlags : uint16_t {
+        audio_vol_change_event      = 0x0010,
+        microphone_vol_change_event = 0x0020,
+        active_con_iap              = 0x0100,
+        active_con_spp              = 0x0200,
+        active_con_a2dp             = 0x0400,
+        active_con_hfphsp           = 0x0800,
+        caller_id_event             = 0x1000,
+        track_change_event          = 0x2000,
+    };
+};
+
+}
+
+#endif /* TEST_NATIVE_STUBS_DRIVERS_WIRELESS_RN_52_H_ */
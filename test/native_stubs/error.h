@@ -0,0 +1,57 @@
+#ifndef TEST_NATIVE_STUBS_ERROR_H_
+#define TEST_NATIVE_STUBS_ERROR_H_
+
+#include <cstdint>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+namespace Libp {
+
+/**
+ * Host stand-in for the Libp error handler. Reports are collected rather
+ * than printed so tests can check them, a halt aborts the test.
+ */
+class Error {
+public:
+    void report(const char* fmt, ...)
+    {
+        char buf[256];
+        va_list args;
+        va_start(args, fmt);
+        vsnprintf(buf, sizeof(buf), fmt, args);
+        va_end(args);
+        log_ += buf;
+    }
+
+    [[noreturn]] void halt(uint8_t code, const char* msg)
+    {
+        printf("halt %u: %s\n", code, msg);
+        abort();
+    }
+
+    /// Everything reported since the last `clearLog`
+    const std::string& log() const
+    {
+        return log_;
+    }
+    void clearLog()
+    {
+        log_.clear();
+    }
+
+private:
+    std::string log_;
+};
+
+}
+
+/// error_handler.cpp drives the debug UART and isn't built on the host
+inline Libp::Error& getErrHndlr()
+{
+    static Libp::Error err;
+    return err;
+}
+
+#endif /* TEST_NATIVE_STUBS_ERROR_H_ */
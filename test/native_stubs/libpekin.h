@@ -0,0 +1,29 @@
+#ifndef TEST_NATIVE_STUBS_LIBPEKIN_H_
+#define TEST_NATIVE_STUBS_LIBPEKIN_H_
+
+#include <cstdint>
+#include <type_traits>
+
+namespace Libp {
+
+template <typename T>
+constexpr std::underlying_type_t<T> enumBaseT(T e)
+{
+    return static_cast<std::underlying_type_t<T>>(e);
+}
+
+/// Host millisecond clock, set by tests
+inline uint32_t host_ms = 0;
+/// Added to `host_ms` on every read so busy waits make progress
+inline uint32_t host_ms_step = 0;
+
+inline uint32_t getMillis()
+{
+    const uint32_t now = host_ms;
+    host_ms += host_ms_step;
+    return now;
+}
+
+}
+
+#endif /* TEST_NATIVE_STUBS_LIBPEKIN_H_ */
@@ -0,0 +1,355 @@
+#include <cstdio>
+#include <map>
+#include <string>
+#include <unity.h>
+#include <drivers/wireless/rn_52.h>
+#include <bt_module.h>
+
+namespace {
+
+/// How long the RN52 takes from "Reboot" to "CMD"
+constexpr uint32_t boot_ms = 400;
+
+constexpr char metadata_reply[] =
+        "AOK\r\n"
+        "Title=Bohemian Rhapsody - Remastered 2011\r\n"
+        "Artist=Queen\r\n"
+        "Album=A Night At The Opera (2011 Remaster)\r\n"
+        "TrackNumber=11\r\n"
+        "TrackCount=12\r\n"
+        "Genre=Rock\r\n"
+        "Time(ms)=354320\r\n";
+
+/**
+ * Scripted RN52 with settings, a stored baud rate and reboots. Settings
+ * and the rate written take effect on the next reboot, as on the module.
+ * A command, or its reply, can be lost to check recovery.
+ */
+struct ScriptedRn52 {
+    Rn52Link& link;
+    std::map<char, std::string> settings;
+    uint32_t stored_baud;
+    /// "SU" is answered with ERR / with AOK but not stored
+    bool reject_su = false;
+    bool forget_su = false;
+    /// Number of the command that is lost / whose reply is lost
+    int lose_cmd = -1;
+    int lose_reply = -1;
+
+    int n_cmds = 0;
+    int n_sets = 0;
+    int n_reboots = 0;
+
+    ScriptedRn52(Rn52Link& l, uint32_t baud) : link(l), stored_baud(baud)
+    {
+        link.peer_baud = baud;
+        link.on_command = [this](const std::string& cmd) { handle(cmd); };
+    }
+
+    void handle(const std::string& cmd)
+    {
+        const int n = n_cmds++;
+        if (n == lose_cmd)
+            return;
+        muted_ = n == lose_reply;
+        if (cmd == "Q")
+            send("0000\r\n");
+        else if (cmd == "AD")
+            send(metadata_reply);
+        else if (cmd == "R,1")
+            reboot();
+        else if (cmd == "SU,09" || cmd == "SU,07") {
+            if (reject_su) {
+                send("ERR\r\n");
+                return;
+            }
+            if (!forget_su)
+                stored_baud = cmd == "SU,09" ? Rn52Link::fast_baud : Rn52Link::default_baud;
+            send("AOK\r\n");
+        }
+        else if (cmd.size() == 2 && cmd[0] == 'G' && settings.count(cmd[1]))
+            send(settings[cmd[1]] + "\r\n");
+        else if (cmd.size() > 2 && cmd[0] == 'S' && cmd[2] == ',' && settings.count(cmd[1])) {
+            settings[cmd[1]] = cmd.substr(3);
+            n_sets++;
+            send("AOK\r\n");
+        }
+        else
+            send("?\r\n");
+    }
+
+    void reboot()
+    {
+        n_reboots++;
+        send("Reboot\r\n");
+        link.peer_baud = stored_baud;
+        const uint32_t turnaround_ms = link.turnaround_ms;
+        link.turnaround_ms = boot_ms;
+        send("CMD\r\n");
+        link.turnaround_ms = turnaround_ms;
+    }
+
+    /// As `BtModule` configures it, some hex values read back padded
+    void configure()
+    {
+        settings = {
+            { 'N', "Bath One" }, { 'C', "00200414" }, { 'D', "04" }, { '|', "0002" },
+            { 'K', "04" }, { 'A', "1" }, { '%', "1000" },
+        };
+    }
+    void factoryReset()
+    {
+        settings = {
+            { 'N', "RN52-5B1C" }, { 'C', "240704" }, { 'D', "07" }, { '|', "0000" },
+            { 'K', "07" }, { 'A', "1" }, { '%', "0000" },
+        };
+    }
+
+private:
+    bool muted_ = false;
+
+    void send(const std::string& text)
+    {
+        if (!muted_)
+            link.reply(text);
+    }
+};
+
+/// Boot as main() does, link first tried at the rate last negotiated
+uint32_t bootToReady(BtModule& bt_module, Rn52Link& link, bool& ok)
+{
+    link.start(Rn52Link::fast_baud);
+    const uint32_t start_ms = Libp::host_ms;
+    ok = bt_module.init();
+    return Libp::host_ms - start_ms;
+}
+
+/// @return true if a status query gets an answer over the link as it is
+bool answersStatus(BtModule& bt_module)
+{
+    bt_module.requestStatus();
+    for (int ms = 0; ms < 1000; ms++)
+        bt_module.poll(Libp::getMillis());
+    return bt_module.lastStatus() != Libp::Rn52::query_status_error;
+}
+
+/// ms from request to `rn52_metadata` with the module and link at `baud`
+uint32_t metadataRoundTrip(uint32_t baud, bool& ok)
+{
+    Rn52Link link;
+    ScriptedRn52 rn52(link, baud);
+    link.start(baud);
+    EventQueue queue;
+    BtModule bt_module(link, queue);
+    TrackInfo info;
+
+    const uint32_t start_ms = Libp::host_ms;
+    bt_module.requestMetadata(info);
+    while (true) {
+        bt_module.poll(Libp::getMillis());
+        while (queue.eventIsPending()) {
+            if (queue.getNextPendingEvent().event_ == EventType::rn52_metadata) {
+                ok = bt_module.lastMetadataOk() && info.duration_ms == 354320;
+                return Libp::host_ms - start_ms;
+            }
+        }
+    }
+}
+
+}
+
+void setUp()
+{
+    Libp::host_ms = 1000;
+    // Blocking waits poll once per ms
+    Libp::host_ms_step = 1;
+    getErrHndlr().clearLog();
+}
+void tearDown() { }
+
+/// Settings already right: all read back, none written, no reboot
+void test_already_configured()
+{
+    Rn52Link link;
+    ScriptedRn52 rn52(link, Rn52Link::fast_baud);
+    rn52.configure();
+    EventQueue queue;
+    BtModule bt_module(link, queue);
+
+    bool ok;
+    const uint32_t ms = bootToReady(bt_module, link, ok);
+    TEST_ASSERT_TRUE(ok);
+    TEST_ASSERT_EQUAL(0, rn52.n_sets);
+    TEST_ASSERT_EQUAL(0, rn52.n_reboots);
+
+    char msg[60];
+    snprintf(msg, sizeof(msg), "Already configured: ready in %lu ms",
+            static_cast<unsigned long>(ms));
+    TEST_MESSAGE(msg);
+}
+
+/// One setting differs: only it is written, then one reboot
+void test_one_setting_differs()
+{
+    Rn52Link link;
+    ScriptedRn52 rn52(link, Rn52Link::fast_baud);
+    rn52.configure();
+    rn52.settings['N'] = "Bath Two";
+    EventQueue queue;
+    BtModule bt_module(link, queue);
+
+    bool ok;
+    bootToReady(bt_module, link, ok);
+    TEST_ASSERT_TRUE(ok);
+    TEST_ASSERT_EQUAL(1, rn52.n_sets);
+    TEST_ASSERT_EQUAL_STRING("Bath One", rn52.settings['N'].c_str());
+    TEST_ASSERT_EQUAL(1, rn52.n_reboots);
+}
+
+/// Factory defaults: every differing setting written, one reboot for them
+void test_fresh_module()
+{
+    Rn52Link link;
+    ScriptedRn52 rn52(link, Rn52Link::default_baud);
+    rn52.factoryReset();
+    EventQueue queue;
+    BtModule bt_module(link, queue);
+
+    bool ok;
+    const uint32_t ms = bootToReady(bt_module, link, ok);
+    TEST_ASSERT_TRUE(ok);
+    // Auth is already right
+    TEST_ASSERT_EQUAL(6, rn52.n_sets);
+    TEST_ASSERT_EQUAL_STRING("Bath One", rn52.settings['N'].c_str());
+    TEST_ASSERT_EQUAL_STRING("0002", rn52.settings['|'].c_str());
+
+    // Configured now, the next boot writes nothing
+    EventQueue queue2;
+    BtModule rebooted(link, queue2);
+    const int n_sets = rn52.n_sets;
+    const int n_reboots = rn52.n_reboots;
+    const uint32_t ms2 = bootToReady(rebooted, link, ok);
+    TEST_ASSERT_TRUE(ok);
+    TEST_ASSERT_EQUAL(n_sets, rn52.n_sets);
+    TEST_ASSERT_EQUAL(n_reboots, rn52.n_reboots);
+
+    char msg[80];
+    snprintf(msg, sizeof(msg), "Fresh module: ready in %lu ms, %lu ms on the next boot",
+            static_cast<unsigned long>(ms), static_cast<unsigned long>(ms2));
+    TEST_MESSAGE(msg);
+}
+
+/// Fresh module switched to the fast rate, which it keeps over reboots
+void test_fast_baud_negotiated()
+{
+    Rn52Link link;
+    ScriptedRn52 rn52(link, Rn52Link::default_baud);
+    rn52.configure();
+    EventQueue queue;
+    BtModule bt_module(link, queue);
+
+    bool ok;
+    bootToReady(bt_module, link, ok);
+    TEST_ASSERT_TRUE(ok);
+    TEST_ASSERT_EQUAL(Rn52Link::fast_baud, rn52.stored_baud);
+    TEST_ASSERT_EQUAL(Rn52Link::fast_baud, link.peer_baud);
+    TEST_ASSERT_EQUAL(Rn52Link::fast_baud, link.baud());
+    // "CMD" was recognised after the switch, not found by probing
+    TEST_ASSERT_TRUE(getErrHndlr().log().find("'R,1' failed") == std::string::npos);
+    TEST_ASSERT_TRUE(getErrHndlr().log().find("baud failed") == std::string::npos);
+}
+
+/// A module that refuses or forgets the rate stays usable at 115200
+void test_fast_baud_fallback()
+{
+    for (bool reject : { true, false }) {
+        Rn52Link link;
+        ScriptedRn52 rn52(link, Rn52Link::default_baud);
+        rn52.configure();
+        rn52.reject_su = reject;
+        rn52.forget_su = !reject;
+        EventQueue queue;
+        BtModule bt_module(link, queue);
+
+        bool ok;
+        bootToReady(bt_module, link, ok);
+        TEST_ASSERT_TRUE(ok);
+        TEST_ASSERT_EQUAL(Rn52Link::default_baud, link.peer_baud);
+        TEST_ASSERT_EQUAL(Rn52Link::default_baud, link.baud());
+        TEST_ASSERT_TRUE(answersStatus(bt_module));
+    }
+}
+
+/**
+ * Lose each command of a fresh module's bring-up in turn, then each reply.
+ * Whatever is lost, the link ends at the module's rate, which is also the
+ * rate the module has stored, and that is one of the two rates.
+ */
+void test_never_stranded()
+{
+    int n_cmds;
+    {
+        Rn52Link link;
+        ScriptedRn52 rn52(link, Rn52Link::default_baud);
+        rn52.factoryReset();
+        EventQueue queue;
+        BtModule bt_module(link, queue);
+        bool ok;
+        bootToReady(bt_module, link, ok);
+        n_cmds = rn52.n_cmds;
+    }
+    TEST_ASSERT_GREATER_THAN(10, n_cmds);
+
+    for (int lose_reply = 0; lose_reply < 2; lose_reply++) {
+        for (int i = 0; i < n_cmds; i++) {
+            Rn52Link link;
+            ScriptedRn52 rn52(link, Rn52Link::default_baud);
+            rn52.factoryReset();
+            if (lose_reply)
+                rn52.lose_reply = i;
+            else
+                rn52.lose_cmd = i;
+            EventQueue queue;
+            BtModule bt_module(link, queue);
+
+            bool ok;
+            bootToReady(bt_module, link, ok);
+            TEST_ASSERT_TRUE(link.peer_baud == Rn52Link::default_baud
+                    || link.peer_baud == Rn52Link::fast_baud);
+            TEST_ASSERT_EQUAL(link.peer_baud, link.baud());
+            TEST_ASSERT_TRUE(answersStatus(bt_module));
+            // A wake from sleep restarts the module at the link's rate
+            // without negotiating
+            TEST_ASSERT_EQUAL(link.baud(), rn52.stored_baud);
+        }
+    }
+}
+
+/// Metadata round trip at each rate, wire time included
+void test_round_trip_benchmark()
+{
+    bool slow_ok, fast_ok;
+    const uint32_t slow_ms = metadataRoundTrip(Rn52Link::default_baud, slow_ok);
+    const uint32_t fast_ms = metadataRoundTrip(Rn52Link::fast_baud, fast_ok);
+    TEST_ASSERT_TRUE(slow_ok && fast_ok);
+    TEST_ASSERT_LESS_OR_EQUAL(slow_ms, fast_ms);
+
+    char msg[80];
+    snprintf(msg, sizeof(msg), "Metadata round trip: %lu ms at %lu, %lu ms at %lu",
+            static_cast<unsigned long>(slow_ms), static_cast<unsigned long>(Rn52Link::default_baud),
+            static_cast<unsigned long>(fast_ms), static_cast<unsigned long>(Rn52Link::fast_baud));
+    TEST_MESSAGE(msg);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_already_configured);
+    RUN_TEST(test_one_setting_differs);
+    RUN_TEST(test_fresh_module);
+    RUN_TEST(test_fast_baud_negotiated);
+    RUN_TEST(test_fast_baud_fallback);
+    RUN_TEST(test_never_stranded);
+    RUN_TEST(test_round_trip_benchmark);
+    return UNITY_END();
+}
@@ -0,0 +1,120 @@
+#include <string>
+#include <unity.h>
+#include <button_service.h>
+
+namespace {
+
+constexpr uint8_t play = 1u << 0;
+constexpr uint8_t next = 1u << 1;
+constexpr uint8_t vol_up = 1u << 3;
+
+/// Events posted by the button service, as a compact string
+struct Recorder {
+    EventQueue queue;
+    ButtonService buttons { queue };
+    std::string events;
+    bool active = false;
+
+    /// Feed one sample per character of `trace`, '1' = `mask` pressed
+    void feed(const char* trace, uint8_t mask)
+    {
+        for (const char* c = trace; *c; c++)
+            sample(*c == '1' ? mask : 0);
+    }
+    /// Feed `n` samples of `levels`
+    void hold(uint8_t levels, uint32_t n)
+    {
+        for (uint32_t i = 0; i < n; i++)
+            sample(levels);
+    }
+    void sample(uint8_t levels)
+    {
+        active = buttons.sample(levels);
+        while (queue.eventIsPending())
+            record(queue.getNextPendingEvent().event_);
+    }
+    void record(EventType type)
+    {
+        switch (type) {
+        case EventType::btn_play:            events += "P "; break;
+        case EventType::btn_play_release:    events += "p "; break;
+        case EventType::btn_play_long_press: events += "L "; break;
+        case EventType::btn_next:            events += "N "; break;
+        case EventType::btn_vol_up:          events += "V "; break;
+        default:                             events += "? "; break;
+        }
+    }
+};
+
+}
+
+void setUp() { }
+void tearDown() { }
+
+/// Contact chatter on press and release gives one press and one release
+void test_chatter()
+{
+    Recorder rec;
+    rec.feed("10101101111", play);
+    TEST_ASSERT_EQUAL_STRING("P ", rec.events.c_str());
+    rec.hold(play, 20);
+    rec.feed("0101001000000", play);
+    TEST_ASSERT_EQUAL_STRING("P p ", rec.events.c_str());
+    TEST_ASSERT_FALSE(rec.active);
+}
+
+/// Spikes shorter than the debounce time never produce an event
+void test_glitches_ignored()
+{
+    Recorder rec;
+    rec.feed("0001000011000111100000", next);
+    rec.feed("1110001101110000111100000", next);
+    TEST_ASSERT_EQUAL_STRING("", rec.events.c_str());
+    TEST_ASSERT_FALSE(rec.active);
+}
+
+/// Noise on another button while one is held doesn't disturb it
+void test_noise_on_other_button()
+{
+    Recorder rec;
+    rec.hold(next, 10);
+    for (int i = 0; i < 50; i++)
+        rec.sample(next | (i % 3 == 0 ? play : 0));
+    rec.hold(0, 10);
+    TEST_ASSERT_EQUAL_STRING("N ", rec.events.c_str());
+}
+
+void test_long_press()
+{
+    Recorder rec;
+    // Pressed on the 5th sample, long press 2 s later
+    rec.hold(play, 5 + ButtonService::long_press_ms / ButtonService::sample_period_ms - 1);
+    TEST_ASSERT_EQUAL_STRING("P ", rec.events.c_str());
+    rec.hold(play, 1);
+    TEST_ASSERT_EQUAL_STRING("P L ", rec.events.c_str());
+    // Only once however long it's held
+    rec.hold(play, 2000);
+    rec.hold(0, 5);
+    TEST_ASSERT_EQUAL_STRING("P L p ", rec.events.c_str());
+}
+
+/// Volume repeats after 500 ms at 200 ms, accelerating by 20 ms to 60 ms:
+/// held 500, 700, 880, 1040, 1180, 1300, 1400, 1480 ms
+void test_volume_auto_repeat()
+{
+    Recorder rec;
+    rec.hold(vol_up, 5 + 1500 / ButtonService::sample_period_ms);
+    rec.hold(0, 5);
+    TEST_ASSERT_EQUAL_STRING("V V V V V V V V V ", rec.events.c_str());
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_chatter);
+    RUN_TEST(test_glitches_ignored);
+    RUN_TEST(test_noise_on_other_button);
+    RUN_TEST(test_long_press);
+    RUN_TEST(test_volume_auto_repeat);
+    return UNITY_END();
+}
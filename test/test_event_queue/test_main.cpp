@@ -0,0 +1,88 @@
+#include <unity.h>
+#include <event_queue.h>
+
+namespace {
+
+/// Dispatch everything pending, as the main loop does
+uint8_t drain(EventQueue& queue, EventType* out, uint8_t max_out)
+{
+    uint8_t n = 0;
+    while (queue.eventIsPending() && n < max_out)
+        out[n++] = queue.getNextPendingEvent().event_;
+    return n;
+}
+
+}
+
+void setUp() { }
+void tearDown() { }
+
+/// An irq storm of coalescable events between button presses. Every press
+/// is kept, in order, and each stormed type is dispatched once after them.
+void test_irq_storm_keeps_buttons()
+{
+    static EventQueue queue;
+    const EventType presses[] = {
+        EventType::btn_next, EventType::btn_next, EventType::btn_vol_up,
+        EventType::btn_prev, EventType::btn_play,
+    };
+    constexpr int n_storm = 1000;
+    int press = 0;
+    for (int i = 0; i < n_storm; i++) {
+        queue.postEvent(EventType::rn52_rx);
+        if (i % 2 == 0)
+            queue.postEvent(EventType::clock_tick);
+        if (i % 200 == 100)
+            queue.postEvent(presses[press++]);
+    }
+    TEST_ASSERT_EQUAL(5, press);
+
+    EventType dispatched[16];
+    const uint8_t n = drain(queue, dispatched, 16);
+    TEST_ASSERT_EQUAL(7, n);
+    // FIFO first
+    for (int i = 0; i < 5; i++)
+        TEST_ASSERT_TRUE(dispatched[i] == presses[i]);
+    // then pending bits in ascending EventType order
+    TEST_ASSERT_TRUE(dispatched[5] == EventType::clock_tick);
+    TEST_ASSERT_TRUE(dispatched[6] == EventType::rn52_rx);
+
+    TEST_ASSERT_EQUAL(0, queue.nDropped());
+    TEST_ASSERT_EQUAL(n_storm - 1, queue.nCoalesced(EventType::rn52_rx));
+    TEST_ASSERT_EQUAL(n_storm / 2 - 1, queue.nCoalesced(EventType::clock_tick));
+}
+
+/// A bit posted again after dispatch is a new event, not a coalesced one
+void test_flag_reposted_after_dispatch()
+{
+    static EventQueue queue;
+    EventType dispatched[4];
+    queue.postEvent(EventType::rn52_status);
+    TEST_ASSERT_EQUAL(1, drain(queue, dispatched, 4));
+    queue.postEvent(EventType::rn52_status);
+    TEST_ASSERT_EQUAL(1, drain(queue, dispatched, 4));
+    TEST_ASSERT_TRUE(dispatched[0] == EventType::rn52_status);
+    TEST_ASSERT_EQUAL(0, queue.nCoalesced(EventType::rn52_status));
+}
+
+/// Only FIFO events can be dropped, and only once the FIFO is full
+void test_fifo_overflow_counted()
+{
+    static EventQueue queue;
+    for (int i = 0; i < 7; i++)
+        queue.postEvent(EventType::btn_next);
+    queue.postEvent(EventType::rn52_rx);
+    EventType dispatched[16];
+    TEST_ASSERT_EQUAL(6, drain(queue, dispatched, 16));
+    TEST_ASSERT_EQUAL(2, queue.nDropped());
+    TEST_ASSERT_TRUE(dispatched[5] == EventType::rn52_rx);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_irq_storm_keeps_buttons);
+    RUN_TEST(test_flag_reposted_after_dispatch);
+    RUN_TEST(test_fifo_overflow_counted);
+    return UNITY_END();
+}
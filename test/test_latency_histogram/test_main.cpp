@@ -0,0 +1,74 @@
+#include <string>
+#include <unity.h>
+#include <event_queue.h>
+#include <latency_histogram.h>
+
+namespace {
+
+/// Report lines of `histogram`, label line excluded
+std::string buckets(const LatencyHistogram& histogram)
+{
+    getErrHndlr().clearLog();
+    histogram.report("t");
+    const std::string log = getErrHndlr().log();
+    return log.substr(log.find('\n') + 1);
+}
+
+}
+
+void setUp() { }
+void tearDown() { }
+
+void test_log2_buckets()
+{
+    LatencyHistogram histogram;
+    histogram.record(0);
+    histogram.record(1);
+    histogram.record(2);
+    histogram.record(3);
+    histogram.record(1023);
+    histogram.record(1024);
+    TEST_ASSERT_EQUAL_STRING(
+            "  <1us: 1\r\n"
+            "  <2us: 1\r\n"
+            "  <4us: 2\r\n"
+            "  <1024us: 1\r\n"
+            "  <2048us: 1\r\n", buckets(histogram).c_str());
+    TEST_ASSERT_EQUAL(6, histogram.count());
+    TEST_ASSERT_EQUAL_UINT32(1024, histogram.worstUs());
+}
+
+/// Anything beyond the range lands in the last bucket, worst case is kept
+void test_overflow_bucket()
+{
+    LatencyHistogram histogram;
+    histogram.record(UINT32_MAX);
+    histogram.record(1u << (LatencyHistogram::n_buckets - 1));
+    TEST_ASSERT_EQUAL_STRING("  <524288us: 2\r\n", buckets(histogram).c_str());
+    TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, histogram.worstUs());
+}
+
+/// A coalesced event is timestamped by its first post, so the latency
+/// covers the whole time it was pending
+void test_coalesced_event_keeps_first_post_time()
+{
+    static EventQueue queue;
+    const uint32_t before = cycleCount();
+    queue.postEvent(EventType::rn52_rx);
+    const uint32_t first = cycleCount();
+    while (cycleCount() - first < 1000)
+        ;
+    queue.postEvent(EventType::rn52_rx);
+    const EventQueue::Event event = queue.getNextPendingEvent();
+    TEST_ASSERT_TRUE(event.event_ == EventType::rn52_rx);
+    TEST_ASSERT_LESS_OR_EQUAL(first - before, event.post_cycles_ - before);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_log2_buckets);
+    RUN_TEST(test_overflow_bucket);
+    RUN_TEST(test_coalesced_event_keeps_first_post_time);
+    return UNITY_END();
+}
@@ -0,0 +1,198 @@
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <unity.h>
+#include <metadata_parser.h>
+
+namespace {
+
+constexpr char typical_response[] =
+        "AOK\r\n"
+        "Title=Bohemian Rhapsody - Remastered 2011\r\n"
+        "Artist=Queen\r\n"
+        "Album=A Night At The Opera (2011 Remaster)\r\n"
+        "TrackNumber=11\r\n"
+        "TrackCount=12\r\n"
+        "Genre=Rock\r\n"
+        "Time(ms)=354320\r\n";
+
+constexpr char utf8_response[] =
+        "AOK\r\n"
+        "Title=Hyv\xc3\xa4\xc3\xa4 y\xc3\xb6t\xc3\xa4 \xe2\x80\x94 Caf\xc3\xa9 \xe2\x80\x9cLive\xe2\x80\x9d\r\n"
+        "Artist=Bj\xc3\xb6rk Gu\xc3\xb0mundsd\xc3\xb3ttir & Stra\xc3\x9f" "e\r\n"
+        "Album=\xc3\x85ngstr\xc3\xb6m\r\n"
+        "TrackNumber=3\r\n"
+        "TrackCount=9\r\n"
+        "Genre=Pop\r\n"
+        "Time(ms)=201000\r\n";
+
+/// xorshift32, deterministic so failures reproduce
+uint32_t rng_state;
+uint32_t nextRandom()
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+MetadataParser::Result feedAll(MetadataParser& parser, const char* data, size_t len)
+{
+    MetadataParser::Result result = MetadataParser::Result::none;
+    for (size_t i = 0; i < len && result != MetadataParser::Result::end; i++)
+        result = parser.feed(data[i]);
+    return result;
+}
+
+void checkText(const TrackInfo& info, TrackField field)
+{
+    const char* text = info.text(field);
+    const size_t len = strnlen(text, TrackInfo::max_text_len + 1);
+    TEST_ASSERT_LESS_OR_EQUAL(TrackInfo::max_text_len, len);
+    // Only characters the font has
+    for (size_t i = 0; i < len; i++)
+        TEST_ASSERT_TRUE(text[i] >= 0x20 && text[i] < 0x7f);
+}
+
+}
+
+void setUp() { }
+void tearDown() { }
+
+void test_typical_response()
+{
+    MetadataParser parser;
+    TrackInfo info;
+    parser.begin(info);
+    TEST_ASSERT_TRUE(feedAll(parser, typical_response, sizeof(typical_response) - 1)
+            == MetadataParser::Result::end);
+    TEST_ASSERT_EQUAL_STRING("Bohemian Rhapsody - Remastered 2011", info.text(TrackField::title));
+    TEST_ASSERT_EQUAL_STRING("Queen", info.text(TrackField::artist));
+    TEST_ASSERT_EQUAL(11, info.track_number);
+    TEST_ASSERT_EQUAL(12, info.track_count);
+    TEST_ASSERT_EQUAL(354320, info.duration_ms);
+}
+
+void test_error_reply()
+{
+    MetadataParser parser;
+    TrackInfo info;
+    parser.begin(info);
+    MetadataParser::Result result = MetadataParser::Result::none;
+    for (const char* c = "ERR\r\n"; *c && result == MetadataParser::Result::none; c++)
+        result = parser.feed(*c);
+    TEST_ASSERT_TRUE(result == MetadataParser::Result::error);
+}
+
+void test_long_title_truncated()
+{
+    MetadataParser parser;
+    TrackInfo info;
+    parser.begin(info);
+    const char* key = "Title=";
+    feedAll(parser, key, strlen(key));
+    for (int i = 0; i < 300; i++)
+        parser.feed('x');
+    TEST_ASSERT_TRUE(parser.feed('\n') == MetadataParser::Result::field_done);
+    TEST_ASSERT_EQUAL(TrackInfo::max_text_len, strlen(info.text(TrackField::title)));
+}
+
+void test_repeated_field_keeps_first()
+{
+    MetadataParser parser;
+    TrackInfo info;
+    parser.begin(info);
+    const char response[] = "Title=First\r\nTitle=Second\r\nArtist=Queen\r\nTime(ms)=1\r\n";
+    feedAll(parser, response, sizeof(response) - 1);
+    TEST_ASSERT_EQUAL_STRING("First", info.text(TrackField::title));
+    TEST_ASSERT_EQUAL_STRING("Queen", info.text(TrackField::artist));
+}
+
+/// A key longer than any known one skips only its own line
+void test_long_key_skipped()
+{
+    MetadataParser parser;
+    TrackInfo info;
+    parser.begin(info);
+    const char line[] = "ThisKeyIsFortyCharactersLongAndUnknown!!=x\r\n";
+    static_assert(sizeof(line) - 1 == 40 + 4);
+    feedAll(parser, line, sizeof(line) - 1);
+    TEST_ASSERT_TRUE(feedAll(parser, typical_response, sizeof(typical_response) - 1)
+            == MetadataParser::Result::end);
+    TEST_ASSERT_EQUAL_STRING("Bohemian Rhapsody - Remastered 2011", info.text(TrackField::title));
+    TEST_ASSERT_EQUAL_STRING("Queen", info.text(TrackField::artist));
+}
+
+/// Random mixes of valid lines, UTF-8 fragments and noise must never
+/// overrun the text arena, leave a field unterminated or store a
+/// character outside the font
+void test_fuzz()
+{
+    static const char* const fragments[] = {
+        "Title=", "Artist=", "Album=", "TrackNumber=", "TrackCount=", "Genre=",
+        "Time(ms)=", "AOK", "ERR", "?", "\r\n", "\n", "=", "\xc3\xa9", "\xe2\x80\x94",
+        "\xf0\x9f\x8e\xb5", "\xc3", "\xe2\x80", "\x80", "\xff", "\xc0\x8a", "0123456789",
+    };
+    constexpr int n_fragments = sizeof(fragments) / sizeof(fragments[0]);
+    rng_state = 0x2545f491;
+
+    for (int run = 0; run < 20000; run++) {
+        MetadataParser parser;
+        TrackInfo info;
+        parser.begin(info);
+        const int n_pieces = nextRandom() % 64;
+        for (int i = 0; i < n_pieces; i++) {
+            const uint32_t r = nextRandom();
+            if (r % 3 == 0) {
+                parser.feed(static_cast<char>(r >> 8));
+                continue;
+            }
+            const char* frag = fragments[(r >> 8) % n_fragments];
+            feedAll(parser, frag, strlen(frag));
+        }
+        checkText(info, TrackField::title);
+        checkText(info, TrackField::artist);
+    }
+}
+
+void test_throughput()
+{
+    const struct {
+        const char* name;
+        const char* data;
+        size_t len;
+    } cases[] = {
+        { "ASCII", typical_response, sizeof(typical_response) - 1 },
+        { "UTF-8", utf8_response, sizeof(utf8_response) - 1 },
+    };
+    constexpr int n_runs = 100000;
+
+    for (const auto& c : cases) {
+        MetadataParser parser;
+        TrackInfo info;
+        const auto start = std::chrono::steady_clock::now();
+        for (int run = 0; run < n_runs; run++) {
+            parser.begin(info);
+            TEST_ASSERT_TRUE(feedAll(parser, c.data, c.len) == MetadataParser::Result::end);
+        }
+        const std::chrono::duration<double, std::nano> elapsed =
+                std::chrono::steady_clock::now() - start;
+        char msg[80];
+        snprintf(msg, sizeof(msg), "%s: %.1f ns/byte, %.0f ns/response",
+                c.name, elapsed.count() / (double(n_runs) * c.len), elapsed.count() / n_runs);
+        TEST_MESSAGE(msg);
+    }
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_typical_response);
+    RUN_TEST(test_error_reply);
+    RUN_TEST(test_long_title_truncated);
+    RUN_TEST(test_repeated_field_keeps_first);
+    RUN_TEST(test_long_key_skipped);
+    RUN_TEST(test_fuzz);
+    RUN_TEST(test_throughput);
+    return UNITY_END();
+}
@@ -0,0 +1,114 @@
+#include <unity.h>
+#include <playback_progress.h>
+
+namespace {
+
+/// `Display::progress_w`
+constexpr uint16_t progress_w = 160;
+
+/**
+ * Runs the progress timer the way `PlayerStateMachine::updateProgress`
+ * does and records what `Display::showProgress` would flush: the whole
+ * bar when drawn first, then the newly filled columns.
+ */
+struct Simulation {
+    PlaybackProgress progress;
+    uint32_t now_ms = 0;
+    uint16_t drawn = 0;
+    uint32_t n_wakeups = 0;
+    uint32_t n_column_flushes = 0;
+    uint32_t n_wider_flushes = 0;
+
+    void start(uint32_t duration_ms)
+    {
+        progress.restart(now_ms);
+        progress.setDuration(duration_ms);
+        progress.resume(now_ms);
+        drawn = progress.filledWidth(now_ms, progress_w);
+    }
+
+    /// Follow the timer up to `until_ms` or until the bar is full
+    void run(uint32_t until_ms)
+    {
+        for (;;) {
+            const uint32_t ms = progress.msToNextPixel(now_ms, progress_w);
+            if (ms == PlaybackProgress::never || now_ms + ms > until_ms)
+                break;
+            now_ms += ms;
+            n_wakeups++;
+            const uint16_t filled = progress.filledWidth(now_ms, progress_w);
+            if (filled == drawn + 1)
+                n_column_flushes++;
+            else if (filled != drawn)
+                n_wider_flushes++;
+            drawn = filled;
+        }
+    }
+};
+
+}
+
+void setUp() { }
+void tearDown() { }
+
+/// A 4 minute track grows the bar a column per wakeup, never more
+void test_four_minute_track()
+{
+    Simulation sim;
+    sim.start(4 * 60'000);
+    sim.run(UINT32_MAX);
+    TEST_ASSERT_EQUAL(progress_w, sim.drawn);
+    TEST_ASSERT_EQUAL(160, sim.n_column_flushes);
+    TEST_ASSERT_EQUAL(0, sim.n_wider_flushes);
+    TEST_ASSERT_EQUAL(160, sim.n_wakeups);
+    TEST_ASSERT_EQUAL(4 * 60'000, sim.now_ms);
+}
+
+/// Wakeups stay one per column when the duration isn't a multiple of
+/// the bar width
+void test_odd_duration()
+{
+    Simulation sim;
+    sim.start(201'337);
+    sim.run(UINT32_MAX);
+    TEST_ASSERT_EQUAL(160, sim.n_column_flushes);
+    TEST_ASSERT_EQUAL(160, sim.n_wakeups);
+}
+
+void test_pause_stops_timer()
+{
+    Simulation sim;
+    sim.start(4 * 60'000);
+    sim.run(60'000);
+    TEST_ASSERT_EQUAL(40, sim.drawn);
+    sim.progress.pause(sim.now_ms);
+    TEST_ASSERT_EQUAL_UINT32(PlaybackProgress::never, sim.progress.msToNextPixel(sim.now_ms, progress_w));
+
+    // Paused for 30 s, resume continues from the same position
+    sim.now_ms += 30'000;
+    sim.progress.resume(sim.now_ms);
+    TEST_ASSERT_EQUAL(40, sim.progress.filledWidth(sim.now_ms, progress_w));
+    sim.run(UINT32_MAX);
+    TEST_ASSERT_EQUAL(160, sim.n_column_flushes);
+    TEST_ASSERT_EQUAL(0, sim.n_wider_flushes);
+    TEST_ASSERT_EQUAL(4 * 60'000 + 30'000, sim.now_ms);
+}
+
+void test_unknown_duration()
+{
+    PlaybackProgress progress;
+    progress.restart(0);
+    progress.resume(0);
+    TEST_ASSERT_EQUAL(0, progress.filledWidth(10'000, progress_w));
+    TEST_ASSERT_EQUAL_UINT32(PlaybackProgress::never, progress.msToNextPixel(10'000, progress_w));
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_four_minute_track);
+    RUN_TEST(test_odd_duration);
+    RUN_TEST(test_pause_stops_timer);
+    RUN_TEST(test_unknown_duration);
+    return UNITY_END();
+}
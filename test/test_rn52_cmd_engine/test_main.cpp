@@ -0,0 +1,477 @@
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <unity.h>
+#include <drivers/wireless/rn_52.h>
+#include <rn52_cmd_engine.h>
+
+namespace {
+
+using R = Rn52Response;
+
+constexpr Rn52Cmd status_cmd  { "Q",   R::status,   100, 2 };
+constexpr Rn52Cmd meta_cmd    { "AD",  R::metadata, 100, 1 };
+constexpr Rn52Cmd vol_up_cmd  { "AV+", R::aok,      100, 0 };
+constexpr Rn52Cmd next_cmd    { "AT+", R::aok,      100, 0 };
+constexpr Rn52Cmd pairing_cmd { "@,1", R::aok,      100, 1 };
+constexpr Rn52Cmd name_cmd    { "GN",  R::value,    100, 2 };
+
+constexpr char metadata_reply[] =
+        "AOK\r\n"
+        "Title=Bohemian Rhapsody\r\n"
+        "Artist=Queen\r\n"
+        "Album=A Night At The Opera\r\n"
+        "TrackNumber=11\r\n"
+        "TrackCount=12\r\n"
+        "Genre=Rock\r\n"
+        "Time(ms)=354320\r\n";
+
+/**
+ * Scripted RN52: answers each command from a table, can stay silent or
+ * reply ERR for the first attempts, and records when commands arrive so
+ * tests can check only one is ever outstanding.
+ */
+struct ScriptedRn52 {
+    Rn52Link& link;
+    /// Attempts of each command to ignore / answer with ERR
+    int n_silent = 0;
+    int n_errors = 0;
+
+    std::vector<std::string> received;
+    /// Commands received while a reply was still on the wire
+    int n_overlapped = 0;
+    uint32_t busy_until_ms = 0;
+
+    explicit ScriptedRn52(Rn52Link& l) : link(l)
+    {
+        link.on_command = [this](const std::string& cmd) { handle(cmd); };
+    }
+
+    void handle(const std::string& cmd)
+    {
+        received.push_back(cmd);
+        if (static_cast<int32_t>(Libp::host_ms - busy_until_ms) < 0)
+            n_overlapped++;
+        if (n_silent > 0) {
+            n_silent--;
+            return;
+        }
+        if (n_errors > 0) {
+            n_errors--;
+            send("ERR\r\n");
+            return;
+        }
+        if (cmd == "Q")
+            send("0C11\r\n");
+        else if (cmd == "AD")
+            send(metadata_reply);
+        else if (cmd == "GN")
+            send("Bath One\r\n");
+        else
+            send("AOK\r\n");
+    }
+
+    void send(const std::string& text)
+    {
+        link.reply(text);
+        // Wire time at 115200 is < 1 ms for these, allow for the turnaround
+        busy_until_ms = Libp::host_ms + link.turnaround_ms + 1
+                + text.size() * 10'000 / link.peer_baud;
+    }
+};
+
+/// Main loop stand-in: poll once per ms until idle or `max_ms` passes
+uint32_t pollUntilIdle(Rn52CmdEngine& engine, uint32_t max_ms = 1000)
+{
+    const uint32_t start = Libp::host_ms;
+    while (!engine.isIdle() && Libp::host_ms - start < max_ms) {
+        Libp::host_ms++;
+        engine.poll(Libp::host_ms);
+    }
+    return Libp::host_ms - start;
+}
+
+uint8_t drain(EventQueue& queue, EventQueue::Event* out, uint8_t max_out)
+{
+    uint8_t n = 0;
+    while (queue.eventIsPending() && n < max_out)
+        out[n++] = queue.getNextPendingEvent();
+    return n;
+}
+
+bool posted(const EventQueue::Event* events, uint8_t n, EventType type)
+{
+    for (uint8_t i = 0; i < n; i++) {
+        if (events[i].event_ == type)
+            return true;
+    }
+    return false;
+}
+
+}
+
+void setUp()
+{
+    Libp::host_ms = 1000;
+    Libp::host_ms_step = 0;
+    getErrHndlr().clearLog();
+}
+void tearDown() { }
+
+/// Commands queued back to back go out one at a time, each as soon as the
+/// previous response has been matched
+void test_pipelined_in_order()
+{
+    Rn52Link link;
+    link.start(Rn52Link::default_baud);
+    ScriptedRn52 rn52(link);
+    EventQueue queue;
+    Rn52CmdEngine engine(link, queue);
+
+    TEST_ASSERT_TRUE(engine.submit(vol_up_cmd));
+    TEST_ASSERT_TRUE(engine.submit(next_cmd));
+    TEST_ASSERT_TRUE(engine.submit(pairing_cmd));
+    TEST_ASSERT_TRUE(engine.submit(status_cmd));
+    // Only the first is on the wire
+    TEST_ASSERT_EQUAL_STRING("AV+\r", link.tx_log.c_str());
+
+    const uint32_t elapsed_ms = pollUntilIdle(engine);
+    TEST_ASSERT_EQUAL_STRING("AV+\rAT+\r@,1\rQ\r", link.tx_log.c_str());
+    TEST_ASSERT_EQUAL(0, rn52.n_overlapped);
+    TEST_ASSERT_EQUAL_HEX16(0x0C11, engine.lastStatus());
+    // Each round trip is the turnaround plus a ms on the wire
+    TEST_ASSERT_LESS_OR_EQUAL(4 * 3, elapsed_ms);
+    TEST_ASSERT_TRUE(engine.msToDeadline(Libp::host_ms) == Rn52CmdEngine::never);
+}
+
+/// The queue refuses commands rather than overwriting them
+void test_queue_full()
+{
+    Rn52Link link;
+    link.start(Rn52Link::default_baud);
+    ScriptedRn52 rn52(link);
+    EventQueue queue;
+    Rn52CmdEngine engine(link, queue);
+
+    // One in flight plus 8 queued
+    int n_accepted = 0;
+    for (int i = 0; i < 12; i++)
+        n_accepted += engine.submit(next_cmd);
+    TEST_ASSERT_EQUAL(9, n_accepted);
+    pollUntilIdle(engine);
+    TEST_ASSERT_EQUAL(9, static_cast<int>(rn52.received.size()));
+}
+
+/// Lines that don't answer the command in flight are unsolicited, and
+/// don't complete it
+void test_response_matching()
+{
+    Rn52Link link;
+    link.start(Rn52Link::default_baud);
+    EventQueue queue;
+    Rn52CmdEngine engine(link, queue);
+    link.on_command = [&link](const std::string&) {
+        link.reply("AVRCP_PAUSE\r\nAOK\r\n0C11\r\n");
+    };
+
+    engine.submit(status_cmd);
+    pollUntilIdle(engine);
+    TEST_ASSERT_EQUAL_HEX16(0x0C11, engine.lastStatus());
+    const std::string& log = getErrHndlr().log();
+    TEST_ASSERT_TRUE(log.find("RN52: AVRCP_PAUSE") != std::string::npos);
+    TEST_ASSERT_TRUE(log.find("RN52: AOK") != std::string::npos);
+
+    EventQueue::Event events[8];
+    const uint8_t n = drain(queue, events, 8);
+    TEST_ASSERT_TRUE(posted(events, n, EventType::rn52_status));
+}
+
+/// A value command takes whatever line comes back
+void test_value_response()
+{
+    Rn52Link link;
+    link.start(Rn52Link::default_baud);
+    ScriptedRn52 rn52(link);
+    EventQueue queue;
+    Rn52CmdEngine engine(link, queue);
+
+    engine.submit(name_cmd);
+    pollUntilIdle(engine);
+    TEST_ASSERT_EQUAL_STRING("Bath One", engine.lastValue());
+}
+
+/// Metadata streams into the `TrackInfo` with an event per field
+void test_metadata()
+{
+    Rn52Link link;
+    link.start(Rn52Link::default_baud);
+    ScriptedRn52 rn52(link);
+    EventQueue queue;
+    Rn52CmdEngine engine(link, queue);
+    TrackInfo info;
+
+    engine.submit(meta_cmd, &info);
+    engine.submit(status_cmd);
+    pollUntilIdle(engine);
+    TEST_ASSERT_TRUE(engine.lastMetadataOk());
+    TEST_ASSERT_EQUAL_STRING("Bohemian Rhapsody", info.text(TrackField::title));
+    TEST_ASSERT_EQUAL_STRING("Queen", info.text(TrackField::artist));
+    TEST_ASSERT_EQUAL(354320, info.duration_ms);
+    // Album and genre are skipped
+    const uint8_t used = trackFieldBit(TrackField::title) | trackFieldBit(TrackField::artist)
+            | trackFieldBit(TrackField::track_number) | trackFieldBit(TrackField::track_count)
+            | trackFieldBit(TrackField::duration);
+    TEST_ASSERT_EQUAL(used, engine.metaFieldsReceived());
+    // Line based again for the next command
+    TEST_ASSERT_EQUAL_HEX16(0x0C11, engine.lastStatus());
+
+    EventQueue::Event events[8];
+    const uint8_t n = drain(queue, events, 8);
+    TEST_ASSERT_TRUE(posted(events, n, EventType::rn52_meta_field));
+    TEST_ASSERT_TRUE(posted(events, n, EventType::rn52_metadata));
+}
+
+/// A lost response is retried after the timeout, as many times as allowed
+void test_timeout_retry()
+{
+    Rn52Link link;
+    link.start(Rn52Link::default_baud);
+    ScriptedRn52 rn52(link);
+    EventQueue queue;
+    Rn52CmdEngine engine(link, queue);
+
+    rn52.n_silent = 2;
+    engine.submit(status_cmd);
+    TEST_ASSERT_EQUAL(status_cmd.timeout_ms, engine.msToDeadline(Libp::host_ms));
+    const uint32_t elapsed_ms = pollUntilIdle(engine);
+    TEST_ASSERT_EQUAL(3, static_cast<int>(rn52.received.size()));
+    TEST_ASSERT_EQUAL_HEX16(0x0C11, engine.lastStatus());
+    TEST_ASSERT_GREATER_THAN(2 * status_cmd.timeout_ms - 1, elapsed_ms);
+    TEST_ASSERT_LESS_OR_EQUAL(2 * status_cmd.timeout_ms + 5, elapsed_ms);
+}
+
+/// Out of retries the command fails, and the next one still goes out
+void test_timeout_fails()
+{
+    Rn52Link link;
+    link.start(Rn52Link::default_baud);
+    ScriptedRn52 rn52(link);
+    EventQueue queue;
+    Rn52CmdEngine engine(link, queue);
+
+    rn52.n_silent = 3;
+    engine.submit(status_cmd);
+    engine.submit(vol_up_cmd);
+    pollUntilIdle(engine);
+    TEST_ASSERT_EQUAL(Libp::Rn52::query_status_error, engine.lastStatus());
+    TEST_ASSERT_TRUE(getErrHndlr().log().find("RN52 'Q' failed") != std::string::npos);
+    TEST_ASSERT_EQUAL_STRING("AV+", rn52.received.back().c_str());
+}
+
+/// ERR is retried straight away, not after the timeout
+void test_error_retry()
+{
+    Rn52Link link;
+    link.start(Rn52Link::default_baud);
+    ScriptedRn52 rn52(link);
+    EventQueue queue;
+    Rn52CmdEngine engine(link, queue);
+
+    rn52.n_errors = 1;
+    engine.submit(pairing_cmd);
+    const uint32_t elapsed_ms = pollUntilIdle(engine);
+    TEST_ASSERT_EQUAL(2, static_cast<int>(rn52.received.size()));
+    TEST_ASSERT_LESS_OR_EQUAL(10, elapsed_ms);
+
+    // Not repeatable, so not retried
+    rn52.n_errors = 1;
+    engine.submit(vol_up_cmd);
+    Libp::host_ms_step = 1;
+    TEST_ASSERT_FALSE(engine.runUntilIdle());
+    TEST_ASSERT_EQUAL(3, static_cast<int>(rn52.received.size()));
+}
+
+/// Lines with no command in flight are reported, not lost
+void test_unsolicited_when_idle()
+{
+    Rn52Link link;
+    link.start(Rn52Link::default_baud);
+    EventQueue queue;
+    Rn52CmdEngine engine(link, queue);
+
+    link.reply("AVRCP_PLAY\r\n");
+    Libp::host_ms += 5;
+    engine.poll(Libp::host_ms);
+    TEST_ASSERT_TRUE(getErrHndlr().log().find("RN52: AVRCP_PLAY") != std::string::npos);
+    TEST_ASSERT_TRUE(engine.isIdle());
+}
+
+/// Take the passkey posted, if any, releasing its payload
+bool takePasskey(EventQueue& queue, char* digits)
+{
+    bool found = false;
+    while (queue.eventIsPending()) {
+        const EventQueue::Event event = queue.getNextPendingEvent();
+        if (event.event_ != EventType::rn52_passkey)
+            continue;
+        if (event.payload_ == PayloadPool::no_payload)
+            return false;
+        memcpy(digits, queue.payloads().get<Passkey>(event.payload_).digits, sizeof(Passkey::digits));
+        queue.payloads().release(event.payload_);
+        found = true;
+    }
+    return found;
+}
+
+/// The passkey line is posted with its digits from the poll that reads it
+void test_passkey_event()
+{
+    Rn52Link link;
+    link.start(Rn52Link::default_baud);
+    EventQueue queue;
+    Rn52CmdEngine engine(link, queue);
+
+    link.reply("Passkey: 042917\r\n");
+    // Not yet arrived
+    engine.poll(Libp::host_ms);
+    char digits[sizeof(Passkey::digits) + 1] = {};
+    TEST_ASSERT_FALSE(takePasskey(queue, digits));
+    Libp::host_ms += 5;
+    engine.poll(Libp::host_ms);
+    TEST_ASSERT_TRUE(takePasskey(queue, digits));
+    TEST_ASSERT_EQUAL_STRING("042917", digits);
+}
+
+/// A passkey among the replies to a command in flight is still posted, and
+/// the command still completes
+void test_passkey_during_command()
+{
+    Rn52Link link;
+    link.start(Rn52Link::default_baud);
+    EventQueue queue;
+    Rn52CmdEngine engine(link, queue);
+    link.on_command = [&link](const std::string&) {
+        link.reply("Passkey: 314159\r\n0C11\r\n");
+    };
+
+    engine.submit(status_cmd);
+    pollUntilIdle(engine);
+    TEST_ASSERT_EQUAL_HEX16(0x0C11, engine.lastStatus());
+    char digits[sizeof(Passkey::digits) + 1] = {};
+    TEST_ASSERT_TRUE(takePasskey(queue, digits));
+    TEST_ASSERT_EQUAL_STRING("314159", digits);
+}
+
+/// Only a run of exactly 6 digits is a passkey
+void test_not_a_passkey()
+{
+    Rn52Link link;
+    link.start(Rn52Link::default_baud);
+    EventQueue queue;
+    Rn52CmdEngine engine(link, queue);
+
+    link.reply("0C11\r\nAddr 1234567\r\n12345\r\n");
+    Libp::host_ms += 5;
+    engine.poll(Libp::host_ms);
+    char digits[sizeof(Passkey::digits) + 1] = {};
+    TEST_ASSERT_FALSE(takePasskey(queue, digits));
+}
+
+/// With the payload pool exhausted the passkey is dropped, not corrupted
+void test_passkey_pool_exhausted()
+{
+    Rn52Link link;
+    link.start(Rn52Link::default_baud);
+    EventQueue queue;
+    Rn52CmdEngine engine(link, queue);
+
+    link.reply("111111\r\n222222\r\n333333\r\n");
+    Libp::host_ms += 5;
+    engine.poll(Libp::host_ms);
+    int n_posted = 0;
+    char first[sizeof(Passkey::digits) + 1] = {};
+    while (queue.eventIsPending()) {
+        const EventQueue::Event event = queue.getNextPendingEvent();
+        if (event.event_ != EventType::rn52_passkey)
+            continue;
+        if (n_posted++ == 0)
+            memcpy(first, queue.payloads().get<Passkey>(event.payload_).digits, 6);
+        queue.payloads().release(event.payload_);
+    }
+    TEST_ASSERT_EQUAL(2, n_posted);
+    TEST_ASSERT_EQUAL_STRING("111111", first);
+
+    // Released blocks are reused
+    link.reply("444444\r\n");
+    Libp::host_ms += 5;
+    engine.poll(Libp::host_ms);
+    char digits[sizeof(Passkey::digits) + 1] = {};
+    TEST_ASSERT_TRUE(takePasskey(queue, digits));
+    TEST_ASSERT_EQUAL_STRING("444444", digits);
+}
+
+/**
+ * Throughput of the queue, and how long the main loop is held up per
+ * command compared with the blocking API, which waited out each round trip
+ */
+void test_throughput_and_stall()
+{
+    Rn52Link link;
+    link.start(Rn52Link::default_baud);
+    ScriptedRn52 rn52(link);
+    EventQueue queue;
+    Rn52CmdEngine engine(link, queue);
+
+    constexpr int n_cmds = 20000;
+    uint32_t n_polls = 0;
+    double max_call_ns = 0;
+    double total_ns = 0;
+    for (int i = 0; i < n_cmds; i++) {
+        const auto start = std::chrono::steady_clock::now();
+        engine.submit(i % 2 ? next_cmd : status_cmd);
+        std::chrono::duration<double, std::nano> call = std::chrono::steady_clock::now() - start;
+        max_call_ns = std::max(max_call_ns, call.count());
+        total_ns += call.count();
+        while (!engine.isIdle()) {
+            Libp::host_ms++;
+            const auto poll_start = std::chrono::steady_clock::now();
+            engine.poll(Libp::host_ms);
+            call = std::chrono::steady_clock::now() - poll_start;
+            max_call_ns = std::max(max_call_ns, call.count());
+            total_ns += call.count();
+            n_polls++;
+        }
+        // Not a benchmark of the error log
+        if (i % 1000 == 0)
+            getErrHndlr().clearLog();
+    }
+    TEST_ASSERT_EQUAL(n_cmds, static_cast<int>(rn52.received.size()));
+    TEST_ASSERT_EQUAL(0, rn52.n_overlapped);
+
+    char msg[120];
+    snprintf(msg, sizeof(msg), "%.0f ns CPU/cmd, %.0f ns longest call, blocking would stall %.1f ms/cmd",
+            total_ns / n_cmds, max_call_ns, double(n_polls) / n_cmds);
+    TEST_MESSAGE(msg);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_pipelined_in_order);
+    RUN_TEST(test_queue_full);
+    RUN_TEST(test_response_matching);
+    RUN_TEST(test_value_response);
+    RUN_TEST(test_metadata);
+    RUN_TEST(test_timeout_retry);
+    RUN_TEST(test_timeout_fails);
+    RUN_TEST(test_error_retry);
+    RUN_TEST(test_unsolicited_when_idle);
+    RUN_TEST(test_passkey_event);
+    RUN_TEST(test_passkey_during_command);
+    RUN_TEST(test_not_a_passkey);
+    RUN_TEST(test_passkey_pool_exhausted);
+    RUN_TEST(test_throughput_and_stall);
+    return UNITY_END();
+}
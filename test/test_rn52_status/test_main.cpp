@@ -0,0 +1,70 @@
+#include <unity.h>
+#include <rn52_status.h>
+
+namespace {
+
+using Flags = Rn52StatusTracker::Flags;
+
+constexpr uint16_t connected = 0x0003;
+constexpr uint16_t streaming = 0x000d;
+constexpr uint16_t a2dp = statusBit(Flags::active_con_a2dp);
+constexpr uint16_t track_event = statusBit(Flags::track_change_event);
+constexpr uint16_t vol_event = statusBit(Flags::audio_vol_change_event);
+
+}
+
+void setUp() { }
+void tearDown() { }
+
+void test_first_status_all_new()
+{
+    Rn52StatusTracker tracker;
+    const auto delta = tracker.update(connected | a2dp);
+    TEST_ASSERT_EQUAL_HEX16(connected | a2dp, delta.changed);
+    TEST_ASSERT_EQUAL_HEX16(0, delta.events);
+}
+
+void test_unchanged_status_empty()
+{
+    Rn52StatusTracker tracker;
+    tracker.update(streaming | a2dp);
+    TEST_ASSERT_TRUE(tracker.update(streaming | a2dp).empty());
+}
+
+void test_state_change_only()
+{
+    Rn52StatusTracker tracker;
+    tracker.update(connected | a2dp);
+    const auto delta = tracker.update(streaming | a2dp);
+    TEST_ASSERT_EQUAL_HEX16(connected ^ streaming, delta.changed);
+    TEST_ASSERT_EQUAL_HEX16(0, delta.events);
+}
+
+/// Events are cleared on read, so a repeated bit is a new event
+void test_repeated_event_reported()
+{
+    Rn52StatusTracker tracker;
+    tracker.update(streaming | a2dp | track_event);
+    const auto delta = tracker.update(streaming | a2dp | track_event | vol_event);
+    TEST_ASSERT_EQUAL_HEX16(0, delta.changed);
+    TEST_ASSERT_EQUAL_HEX16(track_event | vol_event, delta.events);
+}
+
+void test_reset_after_power_cycle()
+{
+    Rn52StatusTracker tracker;
+    tracker.update(streaming | a2dp);
+    tracker.reset();
+    TEST_ASSERT_EQUAL_HEX16(streaming | a2dp, tracker.update(streaming | a2dp).changed);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_first_status_all_new);
+    RUN_TEST(test_unchanged_status_empty);
+    RUN_TEST(test_state_change_only);
+    RUN_TEST(test_repeated_event_reported);
+    RUN_TEST(test_reset_after_power_cycle);
+    return UNITY_END();
+}
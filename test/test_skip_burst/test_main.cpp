@@ -0,0 +1,86 @@
+#include <unity.h>
+#include <skip_burst.h>
+
+namespace {
+
+/// Replay `presses` within one burst window, then end the window until
+/// nothing is pending, as `PlayerStateMachine` does with its timer
+struct Replay {
+    SkipBurst burst;
+    int net_sent = 0;
+    int n_rounds = 0;
+    int max_round = 0;
+
+    void run(const int8_t* presses, int n)
+    {
+        for (int i = 0; i < n; i++)
+            net_sent += burst.press(presses[i], i > 0);
+        do {
+            const int8_t round = burst.takeRound();
+            net_sent += round;
+            n_rounds++;
+            max_round = std::max(max_round, round < 0 ? -round : int(round));
+        } while (burst.hasPending());
+    }
+};
+
+}
+
+void setUp() { }
+void tearDown() { }
+
+/// Ten quick "next" presses move ten tracks, three at a time after the first
+void test_ten_next_presses()
+{
+    const int8_t presses[10] = { 1, 1, 1, 1, 1, 1, 1, 1, 1, 1 };
+    Replay replay;
+    replay.run(presses, 10);
+    TEST_ASSERT_EQUAL(10, replay.net_sent);
+    TEST_ASSERT_EQUAL(3, replay.n_rounds);
+    TEST_ASSERT_EQUAL(SkipBurst::max_per_round, replay.max_round);
+    TEST_ASSERT_EQUAL(10, replay.burst.nPresses());
+    TEST_ASSERT_EQUAL(10, replay.burst.nSent());
+}
+
+/// Opposing presses cancel out before anything is sent
+void test_opposing_presses_cancel()
+{
+    const int8_t presses[10] = { 1, 1, 1, 1, 1, 1, -1, -1, -1, -1 };
+    Replay replay;
+    replay.run(presses, 10);
+    TEST_ASSERT_EQUAL(2, replay.net_sent);
+    TEST_ASSERT_EQUAL(2, replay.burst.nSent());
+}
+
+void test_prev_burst()
+{
+    const int8_t presses[5] = { -1, -1, -1, -1, -1 };
+    Replay replay;
+    replay.run(presses, 5);
+    TEST_ASSERT_EQUAL(-5, replay.net_sent);
+    TEST_ASSERT_EQUAL(2, replay.n_rounds);
+}
+
+/// Presses while a carried over round is pending still count
+void test_press_during_carry_over()
+{
+    SkipBurst burst;
+    int net = burst.press(1, false);
+    for (int i = 0; i < 6; i++)
+        net += burst.press(1, true);
+    net += burst.takeRound();
+    net += burst.press(1, true);
+    while (burst.hasPending())
+        net += burst.takeRound();
+    TEST_ASSERT_EQUAL(8, net);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_ten_next_presses);
+    RUN_TEST(test_opposing_presses_cancel);
+    RUN_TEST(test_prev_burst);
+    RUN_TEST(test_press_during_carry_over);
+    return UNITY_END();
+}
@@ -0,0 +1,68 @@
+#define PROFILE_STAGES
+#include <unity.h>
+#include <stage_profiler.h>
+
+void setUp()
+{
+    getErrHndlr().clearLog();
+}
+void tearDown() { }
+
+void test_min_max_total()
+{
+    StageProfiler profiler;
+    profiler.record(Stage::idle, 300'000);
+    profiler.record(Stage::idle, 100'000);
+    profiler.record(Stage::idle, 200'000);
+    const auto& stats = profiler.stats(Stage::idle);
+    TEST_ASSERT_EQUAL_UINT32(100'000, stats.min_cycles);
+    TEST_ASSERT_EQUAL_UINT32(300'000, stats.max_cycles);
+    TEST_ASSERT_EQUAL(600'000, stats.total_cycles);
+    TEST_ASSERT_EQUAL(3, stats.histogram.count());
+    // Host cycles are ns
+    TEST_ASSERT_EQUAL_UINT32(300, stats.histogram.worstUs());
+}
+
+/// The first sample sets the minimum even if it's larger than 0
+void test_first_sample_is_min()
+{
+    StageProfiler profiler;
+    profiler.record(Stage::brightness, 5'000);
+    TEST_ASSERT_EQUAL_UINT32(5'000, profiler.stats(Stage::brightness).min_cycles);
+}
+
+void test_scope_times_stage()
+{
+    StageProfiler profiler;
+    {
+        StageProfiler::Scope scope(profiler, Stage::sensor_read);
+        const uint32_t start = cycleCount();
+        while (cycleCount() - start < 50'000)
+            ;
+    }
+    const auto& stats = profiler.stats(Stage::sensor_read);
+    TEST_ASSERT_EQUAL(1, stats.histogram.count());
+    TEST_ASSERT_LESS_OR_EQUAL(stats.max_cycles, 50'000u);
+    TEST_ASSERT_EQUAL(0, profiler.stats(Stage::idle).histogram.count());
+}
+
+/// Only stages that ran are reported
+void test_report_skips_idle_stages()
+{
+    StageProfiler profiler;
+    profiler.record(Stage::display_update, 1'000);
+    profiler.report();
+    const std::string& log = getErrHndlr().log();
+    TEST_ASSERT_TRUE(log.find("display_update: min") != std::string::npos);
+    TEST_ASSERT_TRUE(log.find("process_event") == std::string::npos);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_min_max_total);
+    RUN_TEST(test_first_sample_is_min);
+    RUN_TEST(test_scope_times_stage);
+    RUN_TEST(test_report_skips_idle_stages);
+    return UNITY_END();
+}
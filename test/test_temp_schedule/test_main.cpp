@@ -0,0 +1,132 @@
+#include <cstdio>
+#include <unity.h>
+#include <temp_schedule.h>
+
+namespace {
+
+/// BME280 forced measurement, all oversampling x1
+constexpr uint16_t measure_ms = 10;
+
+/**
+ * `PlayerStateMachine::handleClockTick` over the schedule: how long after
+ * the tick the clock is drawn. A reading starts the next measurement.
+ */
+uint32_t tickToDraw(TempSchedule& schedule, uint32_t now_ms)
+{
+    uint32_t delay_ms = 0;
+    switch (schedule.tick(now_ms, measure_ms)) {
+    case TempSchedule::Action::start:
+        schedule.started(now_ms);
+        delay_ms = measure_ms;
+        break;
+    case TempSchedule::Action::wait:
+        delay_ms = schedule.msToResult(now_ms, measure_ms);
+        break;
+    case TempSchedule::Action::read:
+        break;
+    }
+    schedule.started(now_ms + delay_ms);
+    return delay_ms;
+}
+
+}
+
+void setUp() { }
+void tearDown() { }
+
+void test_first_tick_starts()
+{
+    TempSchedule schedule;
+    schedule.wake(5000);
+    TEST_ASSERT_TRUE(schedule.tick(5000, measure_ms) == TempSchedule::Action::start);
+}
+
+/// An hour of minute ticks: only the first waits for the sensor
+void test_minute_ticks_read_completed()
+{
+    TempSchedule schedule;
+    uint32_t now = 1000;
+    schedule.wake(now);
+    uint32_t total_delay_ms = tickToDraw(schedule, now);
+    TEST_ASSERT_EQUAL(measure_ms, total_delay_ms);
+    for (int minute = 1; minute <= 60; minute++) {
+        now += 60'000;
+        TEST_ASSERT_TRUE(schedule.tick(now, measure_ms) == TempSchedule::Action::read);
+        total_delay_ms += tickToDraw(schedule, now);
+    }
+    TEST_ASSERT_EQUAL(measure_ms, total_delay_ms);
+
+    char msg[80];
+    snprintf(msg, sizeof(msg), "Clock drawn %.2f ms after the tick on average, %d ms blocking",
+            total_delay_ms / 61.0, static_cast<int>(measure_ms));
+    TEST_MESSAGE(msg);
+}
+
+/// A tick right after the measurement started waits only for the rest
+void test_early_tick_waits()
+{
+    TempSchedule schedule;
+    schedule.wake(0);
+    schedule.started(60'000);
+    TEST_ASSERT_TRUE(schedule.tick(60'004, measure_ms) == TempSchedule::Action::wait);
+    TEST_ASSERT_EQUAL(measure_ms - 4, schedule.msToResult(60'004, measure_ms));
+    TEST_ASSERT_TRUE(schedule.tick(60'000 + measure_ms, measure_ms) == TempSchedule::Action::read);
+}
+
+/// A reading from before a connection isn't shown
+void test_stale_reading_restarts()
+{
+    TempSchedule schedule;
+    schedule.wake(0);
+    schedule.started(1000);
+    TEST_ASSERT_TRUE(schedule.tick(1000 + TempSchedule::max_age_ms, measure_ms)
+            == TempSchedule::Action::read);
+    TEST_ASSERT_TRUE(schedule.tick(1001 + TempSchedule::max_age_ms, measure_ms)
+            == TempSchedule::Action::start);
+}
+
+/// Wake forgets the measurement from before sleep
+void test_wake_restarts()
+{
+    TempSchedule schedule;
+    schedule.wake(0);
+    schedule.started(60'000);
+    schedule.wake(61'000);
+    TEST_ASSERT_TRUE(schedule.tick(61'000, measure_ms) == TempSchedule::Action::start);
+}
+
+/// Self heating compensation gets the time the measurement started
+void test_secs_active()
+{
+    TempSchedule schedule;
+    schedule.wake(3000);
+    schedule.started(3000 + 125'400);
+    TEST_ASSERT_EQUAL(125, schedule.secsActive());
+}
+
+/// getMillis wraps after 49 days
+void test_millis_wrap()
+{
+    TempSchedule schedule;
+    const uint32_t wake = UINT32_MAX - 30'000;
+    schedule.wake(wake);
+    // Started after the wrap
+    schedule.started(wake + 40'000);
+    TEST_ASSERT_EQUAL(40, schedule.secsActive());
+    TEST_ASSERT_TRUE(schedule.tick(wake + 40'003, measure_ms) == TempSchedule::Action::wait);
+    TEST_ASSERT_EQUAL(measure_ms - 3, schedule.msToResult(wake + 40'003, measure_ms));
+    TEST_ASSERT_TRUE(schedule.tick(wake + 100'000, measure_ms) == TempSchedule::Action::read);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_first_tick_starts);
+    RUN_TEST(test_minute_ticks_read_completed);
+    RUN_TEST(test_early_tick_waits);
+    RUN_TEST(test_stale_reading_restarts);
+    RUN_TEST(test_wake_restarts);
+    RUN_TEST(test_secs_active);
+    RUN_TEST(test_millis_wrap);
+    return UNITY_END();
+}
@@ -0,0 +1,165 @@
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <unity.h>
+#include <libpekin.h>
+#include <timer_service.h>
+
+namespace {
+
+/// Fired timers in order, a letter per `TimerId`
+std::string fired;
+
+void record(void* ctx)
+{
+    fired += static_cast<char>('a' + reinterpret_cast<intptr_t>(ctx));
+}
+
+struct Fixture {
+    EventQueue queue;
+    TimerService timers { queue };
+
+    Fixture()
+    {
+        for (uint8_t i = 0; i < n_timers; i++)
+            timers.setCallback(static_cast<TimerId>(i), record, reinterpret_cast<void*>(intptr_t(i)));
+    }
+};
+
+/// Letter for `id` in `fired`
+char letter(TimerId id)
+{
+    return 'a' + static_cast<char>(id);
+}
+
+std::string letters(std::initializer_list<TimerId> ids)
+{
+    std::string s;
+    for (TimerId id : ids)
+        s += letter(id);
+    return s;
+}
+
+}
+
+void setUp()
+{
+    fired.clear();
+    Libp::host_ms = 1000;
+    Libp::host_ms_step = 0;
+}
+void tearDown() { }
+
+void test_fire_in_expiry_order()
+{
+    static Fixture f;
+    f.timers.startOneShot(TimerId::progress, 30);
+    f.timers.startOneShot(TimerId::animation, 10);
+    f.timers.startOneShot(TimerId::inactivity, 20);
+    TEST_ASSERT_EQUAL_UINT32(10, f.timers.msToNextExpiry(1000));
+    f.timers.processExpired(1019);
+    TEST_ASSERT_EQUAL_STRING(letters({ TimerId::animation }).c_str(), fired.c_str());
+    f.timers.processExpired(1030);
+    TEST_ASSERT_EQUAL_STRING(letters({ TimerId::animation, TimerId::inactivity, TimerId::progress }).c_str(),
+            fired.c_str());
+    TEST_ASSERT_EQUAL_UINT32(TimerService::never, f.timers.msToNextExpiry(1030));
+}
+
+/// Restarting an active timer moves it, earlier or later, without a
+/// second heap entry
+void test_rearm_active_timer()
+{
+    static Fixture f;
+    f.timers.startOneShot(TimerId::feedback, 100);
+    f.timers.startOneShot(TimerId::volume_bar, 50);
+    f.timers.startOneShot(TimerId::feedback, 10);
+    TEST_ASSERT_EQUAL_UINT32(10, f.timers.msToNextExpiry(1000));
+    f.timers.startOneShot(TimerId::feedback, 200);
+    TEST_ASSERT_EQUAL_UINT32(50, f.timers.msToNextExpiry(1000));
+    f.timers.processExpired(1500);
+    TEST_ASSERT_EQUAL_STRING(letters({ TimerId::volume_bar, TimerId::feedback }).c_str(), fired.c_str());
+}
+
+void test_stop_heap_root()
+{
+    static Fixture f;
+    f.timers.startOneShot(TimerId::skip_burst, 5);
+    f.timers.startOneShot(TimerId::track_settle, 40);
+    f.timers.startOneShot(TimerId::rn52_cmd, 15);
+    f.timers.startOneShot(TimerId::menu_message, 25);
+    f.timers.stop(TimerId::skip_burst);
+    TEST_ASSERT_FALSE(f.timers.isActive(TimerId::skip_burst));
+    TEST_ASSERT_EQUAL_UINT32(15, f.timers.msToNextExpiry(1000));
+    f.timers.stop(TimerId::rn52_cmd);
+    TEST_ASSERT_EQUAL_UINT32(25, f.timers.msToNextExpiry(1000));
+    f.timers.processExpired(2000);
+    TEST_ASSERT_EQUAL_STRING(letters({ TimerId::menu_message, TimerId::track_settle }).c_str(), fired.c_str());
+}
+
+/// Deadlines either side of the uint32 ms wraparound keep their order
+void test_wraparound()
+{
+    static Fixture f;
+    Libp::host_ms = UINT32_MAX - 20;
+    f.timers.startOneShot(TimerId::brightness, 50);  // after the wrap, 29
+    f.timers.startOneShot(TimerId::sensor_read, 10); // before, UINT32_MAX - 10
+    f.timers.startPeriodic(TimerId::stats_window, 30);
+    TEST_ASSERT_EQUAL_UINT32(10, f.timers.msToNextExpiry(UINT32_MAX - 20));
+
+    f.timers.processExpired(UINT32_MAX);
+    TEST_ASSERT_EQUAL_STRING(letters({ TimerId::sensor_read }).c_str(), fired.c_str());
+    TEST_ASSERT_EQUAL_UINT32(10, f.timers.msToNextExpiry(UINT32_MAX));
+    f.timers.processExpired(9);
+    TEST_ASSERT_EQUAL_STRING(letters({ TimerId::sensor_read, TimerId::stats_window }).c_str(), fired.c_str());
+    TEST_ASSERT_EQUAL_UINT32(20, f.timers.msToNextExpiry(9));
+    f.timers.processExpired(29);
+    TEST_ASSERT_EQUAL_STRING(letters({ TimerId::sensor_read, TimerId::stats_window, TimerId::brightness }).c_str(),
+            fired.c_str());
+    TEST_ASSERT_EQUAL_UINT32(10, f.timers.msToNextExpiry(29));
+}
+
+/// A late periodic timer fires once and doesn't try to catch up
+void test_periodic_no_catch_up()
+{
+    static Fixture f;
+    f.timers.startPeriodic(TimerId::brightness, 100);
+    f.timers.processExpired(1550);
+    TEST_ASSERT_EQUAL_STRING(letters({ TimerId::brightness }).c_str(), fired.c_str());
+    TEST_ASSERT_EQUAL_UINT32(100, f.timers.msToNextExpiry(1550));
+}
+
+void test_throughput()
+{
+    static Fixture f;
+    constexpr uint32_t n_ops = 1'000'000;
+    uint32_t rng = 0x9e3779b9;
+    const auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < n_ops; i++) {
+        rng ^= rng << 13;
+        rng ^= rng >> 17;
+        rng ^= rng << 5;
+        const TimerId id = static_cast<TimerId>(rng % n_timers);
+        if (rng & 0x100)
+            f.timers.startOneShot(id, (rng >> 9) % 1000);
+        else
+            f.timers.stop(id);
+        if ((i & 0xf) == 0)
+            f.timers.processExpired(Libp::host_ms++);
+    }
+    const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    char msg[64];
+    snprintf(msg, sizeof(msg), "%.1f ns per start/stop", elapsed.count() / n_ops);
+    TEST_MESSAGE(msg);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_fire_in_expiry_order);
+    RUN_TEST(test_rearm_active_timer);
+    RUN_TEST(test_stop_heap_root);
+    RUN_TEST(test_wraparound);
+    RUN_TEST(test_periodic_no_catch_up);
+    RUN_TEST(test_throughput);
+    return UNITY_END();
+}
@@ -0,0 +1,170 @@
+#include <cstdio>
+#include <string>
+#include <unity.h>
+#include <rn52_cmd_engine.h>
+#include <track_cache.h>
+
+namespace {
+
+constexpr Rn52Cmd metadata_cmd { "AD", Rn52Response::metadata, 100, 1 };
+
+constexpr char metadata_reply[] =
+        "AOK\r\n"
+        "Title=Bohemian Rhapsody\r\n"
+        "Artist=Queen\r\n"
+        "Album=A Night At The Opera\r\n"
+        "TrackNumber=11\r\n"
+        "TrackCount=12\r\n"
+        "Genre=Rock\r\n"
+        "Time(ms)=354320\r\n";
+
+/**
+ * The cache calls `PlayerStateMachine` makes on RN52 events, with metadata
+ * fetched over a scripted link so the UART traffic can be counted
+ */
+struct Session {
+    Rn52Link link;
+    EventQueue queue;
+    Rn52CmdEngine engine { link, queue };
+    TrackCache cache;
+    TrackInfo info;
+    bool use_cache;
+    bool streaming = false;
+    int n_fetches = 0;
+    int n_redraws = 0;
+
+    explicit Session(bool cached) : use_cache(cached)
+    {
+        link.start(Rn52Link::default_baud);
+        link.on_command = [this](const std::string&) { link.reply(metadata_reply); };
+    }
+
+    /// `handleTrackSettled`
+    void fetch()
+    {
+        n_fetches++;
+        engine.submit(metadata_cmd, &info);
+        while (!engine.isIdle()) {
+            Libp::host_ms++;
+            engine.poll(Libp::host_ms);
+        }
+        // `handleMetadata`
+        if (engine.lastMetadataOk())
+            cache.store();
+    }
+
+    /// `handleModuleStateChg(connected_streaming)`
+    void resume()
+    {
+        streaming = true;
+        if (use_cache && cache.lookup())
+            n_redraws++;
+        else
+            fetch();
+    }
+    /// `handleModuleStateChg(connected)`
+    void pause()
+    {
+        streaming = false;
+    }
+    /// `handleModuleStateChg(disconnected)`
+    void disconnect()
+    {
+        streaming = false;
+        cache.invalidate();
+    }
+    /// `handleTrackEvent`, fetched once the skip settles
+    void trackChange()
+    {
+        cache.invalidate();
+        if (streaming)
+            fetch();
+    }
+
+    uint32_t uartBytes() const
+    {
+        return link.n_bytes_written + link.n_bytes_received;
+    }
+};
+
+/// 5 tracks paused and resumed 20 times each, the phone dropping out once
+void runSession(Session& session)
+{
+    session.resume();
+    for (int track = 0; track < 5; track++) {
+        if (track > 0)
+            session.trackChange();
+        for (int i = 0; i < 20; i++) {
+            session.pause();
+            session.resume();
+        }
+        if (track == 2) {
+            session.disconnect();
+            session.resume();
+        }
+    }
+}
+
+}
+
+void setUp() { }
+void tearDown() { }
+
+void test_miss_before_first_fetch()
+{
+    TrackCache cache;
+    TEST_ASSERT_FALSE(cache.lookup());
+}
+
+void test_hit_after_fetch()
+{
+    TrackCache cache;
+    cache.store();
+    TEST_ASSERT_TRUE(cache.lookup());
+    // Pause/resume repeatedly without a track change
+    TEST_ASSERT_TRUE(cache.lookup());
+}
+
+void test_track_change_invalidates()
+{
+    TrackCache cache;
+    cache.store();
+    cache.invalidate();
+    TEST_ASSERT_FALSE(cache.lookup());
+    cache.store();
+    TEST_ASSERT_TRUE(cache.lookup());
+}
+
+/// Pause/resume heavy session: only track changes and reconnects fetch
+void test_pause_resume_session()
+{
+    constexpr uint32_t bytes_per_fetch = sizeof("AD\r") - 1 + sizeof(metadata_reply) - 1;
+
+    Session cached(true);
+    runSession(cached);
+    // First play, 4 track changes and the reconnect
+    TEST_ASSERT_EQUAL(6, cached.n_fetches);
+    TEST_ASSERT_EQUAL(5 * 20, cached.n_redraws);
+    TEST_ASSERT_EQUAL(6 * bytes_per_fetch, cached.uartBytes());
+
+    Session uncached(false);
+    runSession(uncached);
+    TEST_ASSERT_EQUAL(6 + 5 * 20, uncached.n_fetches);
+    TEST_ASSERT_EQUAL((6 + 5 * 20) * bytes_per_fetch, uncached.uartBytes());
+
+    char msg[80];
+    snprintf(msg, sizeof(msg), "UART bytes: %lu cached, %lu uncached",
+            static_cast<unsigned long>(cached.uartBytes()),
+            static_cast<unsigned long>(uncached.uartBytes()));
+    TEST_MESSAGE(msg);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_miss_before_first_fetch);
+    RUN_TEST(test_hit_after_fetch);
+    RUN_TEST(test_track_change_invalidates);
+    RUN_TEST(test_pause_resume_session);
+    return UNITY_END();
+}
@@ -0,0 +1,86 @@
+#include <cstring>
+#include <unity.h>
+#include <metadata_parser.h>
+#include <utf8.h>
+
+namespace {
+
+/// Decode `bytes`, collecting the code points
+uint8_t decode(const char* bytes, uint32_t* out, uint8_t max_out)
+{
+    Utf8Decoder decoder;
+    uint8_t n = 0;
+    for (const char* b = bytes; *b && n < max_out; b++) {
+        const uint32_t cp = decoder.feed(*b);
+        if (cp != Utf8Decoder::none)
+            out[n++] = cp;
+    }
+    return n;
+}
+
+/// Title stored for the text value `value`
+const char* parseTitle(TrackInfo& info, const char* value)
+{
+    MetadataParser parser;
+    parser.begin(info);
+    for (const char* c = "Title="; *c; c++)
+        parser.feed(*c);
+    for (const char* c = value; *c; c++)
+        parser.feed(*c);
+    parser.feed('\n');
+    return info.text(TrackField::title);
+}
+
+}
+
+void setUp() { }
+void tearDown() { }
+
+void test_decode_sequences()
+{
+    uint32_t cps[8];
+    TEST_ASSERT_EQUAL(4, decode("a\xc3\xa9\xe2\x80\xa6\xf0\x9f\x8e\xb5", cps, 8));
+    TEST_ASSERT_EQUAL_UINT32('a', cps[0]);
+    TEST_ASSERT_EQUAL_UINT32(0xe9, cps[1]);
+    TEST_ASSERT_EQUAL_UINT32(0x2026, cps[2]);
+    TEST_ASSERT_EQUAL_UINT32(0x1f3b5, cps[3]);
+}
+
+void test_decode_invalid()
+{
+    uint32_t cps[8];
+    // Stray continuation, truncated sequence dropped, invalid lead byte
+    TEST_ASSERT_EQUAL(3, decode("\x80" "\xc3" "b\xff", cps, 8));
+    TEST_ASSERT_EQUAL_UINT32(Utf8Decoder::invalid, cps[0]);
+    TEST_ASSERT_EQUAL_UINT32('b', cps[1]);
+    TEST_ASSERT_EQUAL_UINT32(Utf8Decoder::invalid, cps[2]);
+}
+
+void test_transliterate()
+{
+    TEST_ASSERT_EQUAL_STRING("e", transliterate(0xe9));
+    TEST_ASSERT_EQUAL_STRING("ss", transliterate(0xdf));
+    TEST_ASSERT_EQUAL_STRING("...", transliterate(0x2026));
+    TEST_ASSERT_EQUAL_STRING("\"", transliterate(0x201c));
+    TEST_ASSERT_EQUAL_STRING("?", transliterate(0x1f3b5));
+    TEST_ASSERT_EQUAL_STRING("?", transliterate(Utf8Decoder::invalid));
+    TEST_ASSERT_EQUAL_STRING("?", transliterate(0x85));
+}
+
+void test_parser_stores_ascii_only()
+{
+    TrackInfo info;
+    TEST_ASSERT_EQUAL_STRING("Cafe ... Strasse", parseTitle(info, "Caf\xc3\xa9 \xe2\x80\xa6 Stra\xc3\x9f" "e"));
+    // Tab, DEL and an overlong line feed
+    TEST_ASSERT_EQUAL_STRING("a?b?c?", parseTitle(info, "a\tb\x7f" "c\xc0\x8a"));
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_decode_sequences);
+    RUN_TEST(test_decode_invalid);
+    RUN_TEST(test_transliterate);
+    RUN_TEST(test_parser_stores_ascii_only);
+    return UNITY_END();
+}
@@ -0,0 +1,76 @@
+#include <unity.h>
+#include <volume_model.h>
+
+void setUp() { }
+void tearDown() { }
+
+void test_starts_unknown()
+{
+    VolumeModel volume;
+    TEST_ASSERT_FALSE(volume.isKnown());
+    TEST_ASSERT_EQUAL(0, volume.low());
+    TEST_ASSERT_EQUAL(VolumeModel::max_level, volume.high());
+}
+
+/// Pressing against the top narrows the range down to the exact level
+void test_limit_narrows_range()
+{
+    VolumeModel volume;
+    for (int i = 0; i < VolumeModel::max_level; i++) {
+        volume.stepUp();
+        volume.notifyChanged();
+    }
+    TEST_ASSERT_TRUE(volume.isKnown());
+    TEST_ASSERT_EQUAL(VolumeModel::max_level, volume.low());
+    volume.stepDown();
+    volume.notifyChanged();
+    TEST_ASSERT_TRUE(volume.isKnown());
+    TEST_ASSERT_EQUAL(VolumeModel::max_level - 1, volume.low());
+}
+
+/// One event may confirm several of our steps
+void test_own_steps_not_external()
+{
+    VolumeModel volume;
+    for (int i = 0; i < VolumeModel::max_level; i++)
+        volume.stepDown();
+    volume.stepUp();
+    volume.stepUp();
+    volume.notifyChanged();
+    TEST_ASSERT_TRUE(volume.isKnown());
+    TEST_ASSERT_EQUAL(2, volume.low());
+}
+
+void test_external_change_forgets()
+{
+    VolumeModel volume;
+    for (int i = 0; i < VolumeModel::max_level; i++)
+        volume.stepDown();
+    volume.notifyChanged();
+    TEST_ASSERT_TRUE(volume.isKnown());
+    volume.notifyChanged();
+    TEST_ASSERT_FALSE(volume.isKnown());
+}
+
+/// No event comes for a step against the limit, so it isn't waited for
+void test_step_against_limit_not_counted()
+{
+    VolumeModel volume;
+    for (int i = 0; i < VolumeModel::max_level; i++)
+        volume.stepDown();
+    volume.notifyChanged();
+    volume.stepDown();
+    volume.notifyChanged();
+    TEST_ASSERT_FALSE(volume.isKnown());
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_starts_unknown);
+    RUN_TEST(test_limit_narrows_range);
+    RUN_TEST(test_own_steps_not_external);
+    RUN_TEST(test_external_change_forgets);
+    RUN_TEST(test_step_against_limit_not_counted);
+    return UNITY_END();
+}
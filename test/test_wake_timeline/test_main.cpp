@@ -0,0 +1,46 @@
+#include <unity.h>
+#include <wake_timeline.h>
+
+void setUp() { }
+void tearDown() { }
+
+void test_marks_relative_to_wake()
+{
+    WakeTimeline timeline;
+    timeline.start(10'000);
+    timeline.mark(WakeMark::rn52_booted, 11'200);
+    timeline.mark(WakeMark::reconnect_sent, 11'210);
+    TEST_ASSERT_EQUAL_UINT32(1'200, timeline.msTo(WakeMark::rn52_booted));
+    TEST_ASSERT_EQUAL_UINT32(1'210, timeline.msTo(WakeMark::reconnect_sent));
+    TEST_ASSERT_EQUAL_UINT32(WakeTimeline::never, timeline.msTo(WakeMark::connected));
+}
+
+/// A reconnect after a dropout doesn't move the first connection
+void test_first_occurrence_only()
+{
+    WakeTimeline timeline;
+    timeline.start(0);
+    timeline.mark(WakeMark::connected, 3'000);
+    timeline.mark(WakeMark::connected, 9'000);
+    TEST_ASSERT_EQUAL_UINT32(3'000, timeline.msTo(WakeMark::connected));
+}
+
+void test_restart_clears_marks()
+{
+    WakeTimeline timeline;
+    timeline.start(0);
+    timeline.mark(WakeMark::streaming, 4'000);
+    timeline.start(60'000);
+    TEST_ASSERT_EQUAL_UINT32(WakeTimeline::never, timeline.msTo(WakeMark::streaming));
+    timeline.mark(WakeMark::streaming, 62'500);
+    TEST_ASSERT_EQUAL_UINT32(2'500, timeline.msTo(WakeMark::streaming));
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_marks_relative_to_wake);
+    RUN_TEST(test_first_occurrence_only);
+    RUN_TEST(test_restart_clears_marks);
+    return UNITY_END();
+}